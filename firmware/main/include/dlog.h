@@ -0,0 +1,96 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+
+// {{ deferred logging
+
+/*
+ * Logging macros which do not format the message on the calling task. Format string pointer,
+ * raw arguments and timestamp are written into the ring of the current core, and formatted by
+ * a low priority task later. Strings passed as %s arguments are copied (truncated), so they
+ * don't need to outlive the call. Messages are formatted synchronously until dlog_init().
+ *
+ * Supported conversions are the ones of printf, except %n and * width or precision.
+ */
+
+#ifdef CONFIG_NFCITY_DLOG_ENABLE
+#define DLOG_LEVEL_LOCAL(level, tag, format, ...)                                                                      \
+    do {                                                                                                               \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                                                              \
+            dlog_write(level, tag, format, ##__VA_ARGS__);                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+#else
+#define DLOG_LEVEL_LOCAL(level, tag, format, ...) ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__)
+#endif
+
+#define DLOGE(tag, format, ...) DLOG_LEVEL_LOCAL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG_LEVEL_LOCAL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG_LEVEL_LOCAL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) DLOG_LEVEL_LOCAL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define DLOGV(tag, format, ...) DLOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#define DLOG_ARGS_SIZE_MAX     112 // raw arguments of a record, arguments which don't fit are dropped
+#define DLOG_STRING_LENGTH_MAX 47 // %s arguments are truncated to this length, message ids (36) fit
+#define DLOG_BATCH_SIZE_MAX    512 // raw records passed to the sink at once
+
+/**
+ * ESP_GOTO_ON_ERROR which logs with DLOGE
+ */
+#define DLOG_GOTO_ON_ERROR(x, goto_tag, log_tag, format, ...)                                                         \
+    do {                                                                                                               \
+        esp_err_t err_rc_ = (x);                                                                                       \
+        if (unlikely(err_rc_ != ESP_OK)) {                                                                             \
+            DLOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__);                                  \
+            ret = err_rc_;                                                                                             \
+            goto goto_tag;                                                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+/*
+ * Raw record, as passed to the sink. All fields are little-endian. Addresses refer to the strings
+ * in the firmware image, so records can be formatted on host from the elf (see tools/dlog).
+ *
+ * Arguments follow the header, one per conversion of the format string, in order:
+ * - integers with their C size on the device: 4 bytes for int, long, size_t and pointers, 8 bytes for long long
+ * - doubles as 8 bytes
+ * - strings as 1 byte of length followed by the characters (without terminator)
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t format; // address of the format string
+    uint32_t tag; // address of the tag
+    uint32_t timestamp_ms; // since boot
+    uint8_t level;
+    uint8_t core;
+    uint16_t args_size;
+} dlog_record_t;
+
+/**
+ * Receives batches of raw records instead of their formatting
+ *
+ * @param dropped Number of records dropped because rings were full, since the previous batch
+ */
+typedef void (*dlog_sink_t)(const uint8_t *records, size_t size, uint32_t dropped);
+
+/**
+ * Allocates the rings and starts the task which formats the records.
+ * Returns ESP_ERR_NOT_SUPPORTED if deferred logging is disabled.
+ */
+esp_err_t dlog_init();
+
+void dlog_write(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * Records are passed to @p sink instead of being formatted. NULL restores formatting.
+ * Has no effect if deferred logging is disabled.
+ */
+void dlog_set_sink(dlog_sink_t sink);
+
+// }} deferred logging
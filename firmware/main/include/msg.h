@@ -2,8 +2,11 @@
 
 #include <inttypes.h>
 #include "esp_log.h"
+#include "dlog.h"
 #include "cbor.h"
 #include "picc/rc522_mifare.h"
+#include "snap_store.h"
+#include "rf_sched.h"
 
 // {{ common
 
@@ -13,7 +16,7 @@ extern const char *MSG_LOG_TAG;
     do {                                                                                                               \
         CborError err_rc_ = (expression);                                                                              \
         if (unlikely(err_rc_ != CborNoError)) {                                                                        \
-            ESP_LOGE(MSG_LOG_TAG, "%s(%d): => %d", __FUNCTION__, __LINE__, err_rc_);                                   \
+            DLOGE(MSG_LOG_TAG, "%s(%d): => %d", __FUNCTION__, __LINE__, err_rc_);                                      \
             return err_rc_;                                                                                            \
         }                                                                                                              \
     }                                                                                                                  \
@@ -22,7 +25,7 @@ extern const char *MSG_LOG_TAG;
 #define CBOR_RETCHECK(condition, err_code)                                                                             \
     {                                                                                                                  \
         if (unlikely(!(condition))) {                                                                                  \
-            ESP_LOGE(MSG_LOG_TAG, "%s(%d): %s => %d", __FUNCTION__, __LINE__, #condition, err_code);                   \
+            DLOGE(MSG_LOG_TAG, "%s(%d): %s => %d", __FUNCTION__, __LINE__, #condition, err_code);                      \
             return err_code;                                                                                           \
         }                                                                                                              \
     }                                                                                                                  \
@@ -30,47 +33,28 @@ extern const char *MSG_LOG_TAG;
 
 #define MSG_ID_FIELD   "$id"
 #define MSG_KIND_FIELD "$kind"
-#define MSG_CTX_FIELD  "$ctx"
-#define MSG_KEY_FIELD  "$key"
 
+/**
+ * Buffer the message is encoded to, length is set once the whole message is encoded
+ */
 typedef struct
 {
-    uint8_t value[RC522_MIFARE_KEY_SIZE];
-    rc522_mifare_key_type_t type;
-} msg_picc_key_t;
+    uint8_t *buffer;
+    size_t size;
+    size_t length;
+} enc_frame_t;
 
-// }} common
-
-// {{ decoding
+#define ENC_FRAME_INIT(array) { .buffer = (array), .size = sizeof(array), .length = 0 }
 
-typedef enum
-{
-    WEB_MSG_UNKNOWN = -1,
-    WEB_MSG_UNDEFINED = 0,
-    WEB_MSG_PING,
-    WEB_MSG_GET_PICC,
-    WEB_MSG_READ_SECTOR,
-    WEB_MSG_WRITE_BLOCK,
-} web_msg_kind_t;
-
-typedef struct
-{
-    char id[36 + 1]; // uuid
-    web_msg_kind_t kind;
-} web_msg_t;
+// }} common
 
-typedef struct
-{
-    uint8_t offset;
-    msg_picc_key_t key;
-} web_read_sector_msg_t;
+/*
+ * Message shapes, kinds, bounds, wire structs and the encoders/decoders built on them are generated
+ * from protocol/schema.json. Functions below adapt them to the types of the firmware.
+ */
+#include "msg_schema.h"
 
-typedef struct
-{
-    uint8_t address;
-    uint8_t data[RC522_MIFARE_BLOCK_SIZE];
-    msg_picc_key_t key;
-} web_write_block_msg_t;
+// {{ decoding
 
 CborError dec_msg(const uint8_t *buffer, size_t buffer_size, web_msg_t *out_msg);
 
@@ -78,33 +62,110 @@ CborError dec_read_sector_msg(const uint8_t *buffer, size_t buffer_size, web_rea
 
 CborError dec_write_block_msg(const uint8_t *buffer, size_t buffer_size, web_write_block_msg_t *out_write_block_msg);
 
-// }} decoding
-
-// {{ encoding
-
-#define ENC_HELLO_MSG_KIND              "hello"
-#define ENC_ERROR_MSG_KIND              "error"
-#define ENC_PONG_MSG_KIND               "pong"
-#define ENC_PICC_MSG_KIND               "picc"
-#define ENC_PICC_STATE_CHANGED_MSG_KIND "picc_state_changed"
-#define ENC_PICC_SECTOR_MSG_KIND        "picc_sector"
-#define ENC_PICC_BLOCK_MSG_KIND         "picc_block"
-
-#define ENC_BUFFER_SIZE                 (1024)
+/**
+ * Unsigned integer not greater than @p max, used by the generated decoders
+ */
+CborError dec_uint(const CborValue *value, uint64_t max, uint64_t *out_result);
 
-CborError enc_hello_message(CborEncoder *encoder);
+/**
+ * Byte string of exactly @p length bytes, used by the generated decoders
+ */
+CborError dec_byte_string(const CborValue *value, uint8_t *out_data, size_t length);
 
-CborError enc_error_message(web_msg_t *ctx, CborEncoder *encoder, int64_t error_code);
+/**
+ * Whether the optional field is present, used by the generated decoders
+ */
+bool dec_is_present(const CborValue *value);
 
-CborError enc_pong_message(web_msg_t *ctx, CborEncoder *encoder);
-
-CborError enc_picc_message(web_msg_t *ctx, CborEncoder *encoder, rc522_picc_t *picc);
-
-CborError enc_picc_state_changed_message(CborEncoder *encoder, rc522_picc_t *picc, rc522_picc_state_t old_state);
+// }} decoding
 
-CborError enc_picc_sector_message(
-    web_msg_t *ctx, CborEncoder *encoder, rc522_mifare_sector_desc_t *sector_desc, uint8_t *sector_data);
+// {{ encoding
 
-CborError enc_picc_block_message(web_msg_t *ctx, CborEncoder *encoder, uint8_t address, uint8_t *data);
+#define ENC_BUFFER_SIZE ENC_SIZE_MAX
+
+/**
+ * Copies the pre-encoded @p prefix (single byte map header which counts required fields only, $kind, ...)
+ * to the start of the frame and initializes @p out_encoder for the rest of the message.
+ * Map header is incremented by @p optional_count of present optional fields. Used by the generated encoders.
+ */
+CborError enc_frame_begin(enc_frame_t *frame,
+    const uint8_t *prefix,
+    size_t prefix_length,
+    uint8_t optional_count,
+    CborEncoder *out_encoder);
+
+CborError enc_frame_end(enc_frame_t *frame, const CborEncoder *encoder);
+
+/**
+ * Device timestamps (esp_timer_get_time()) of the request handling, attached to its reply.
+ * Publish time is taken when the reply is encoded, right before it is sent.
+ */
+typedef struct
+{
+    int64_t rx_us; // request received by the transport
+    int64_t rf_start_us; // card access started, zero if the request did not need the card
+    int64_t rf_end_us;
+} reply_timing_t;
+
+/**
+ * Sent on connection with the broker (without @p ctx), and in response to hello.
+ * @p lan_url of the local websocket endpoint is omitted if NULL.
+ */
+CborError enc_hello_message(web_msg_t *ctx, enc_frame_t *frame, const char *lan_url);
+
+/**
+ * Replies below omit the timestamps if @p timing is NULL
+ */
+CborError enc_error_message(web_msg_t *ctx, enc_frame_t *frame, int64_t error_code, const reply_timing_t *timing);
+
+/**
+ * Device uptime in @p timing lets the client estimate the offset of its clock
+ */
+CborError enc_pong_message(web_msg_t *ctx, enc_frame_t *frame, const reply_timing_t *timing);
+
+CborError enc_picc_message(web_msg_t *ctx, enc_frame_t *frame, rc522_picc_t *picc);
+
+CborError enc_picc_state_changed_message(enc_frame_t *frame, rc522_picc_t *picc, rc522_picc_state_t old_state);
+
+/**
+ * Blocks marked in the @p gaps bitmask are encoded with null data.
+ * Message without @p ctx is an unsolicited update of the sector (e.g. after snapshot re-verification).
+ */
+CborError enc_picc_sector_message(web_msg_t *ctx,
+    enc_frame_t *frame,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *sector_data,
+    uint16_t gaps,
+    const reply_timing_t *timing);
+
+CborError enc_picc_block_message(
+    web_msg_t *ctx, enc_frame_t *frame, uint8_t address, uint8_t *data, const reply_timing_t *timing);
+
+/**
+ * Broadcast to all clients after successful write of the block of the @p picc
+ */
+CborError enc_picc_block_changed_message(enc_frame_t *frame, rc522_picc_t *picc, uint8_t address, uint8_t *data);
+
+CborError enc_snapshot_message(web_msg_t *ctx, enc_frame_t *frame, const snap_sector_t *sector);
+
+/**
+ * Terminates the sequence of snapshot messages sent in response to get_snapshots
+ */
+CborError enc_snapshots_message(web_msg_t *ctx, enc_frame_t *frame, uint32_t count);
+
+CborError enc_trace_chunk_message(
+    web_msg_t *ctx, enc_frame_t *frame, uint32_t offset, const uint8_t *chunk, size_t length);
+
+/**
+ * Terminates the sequence of trace chunk messages sent in response to get_trace
+ */
+CborError enc_trace_message(web_msg_t *ctx, enc_frame_t *frame, uint32_t size);
+
+CborError enc_rf_stats_message(web_msg_t *ctx, enc_frame_t *frame, const rf_sched_stats_t *stats);
+
+/**
+ * Batch of raw deferred log records (see dlog_record_t), decoded on host with the firmware elf
+ */
+CborError enc_log_message(enc_frame_t *frame, const uint8_t *records, size_t size, uint32_t dropped);
 
 // }} encoding
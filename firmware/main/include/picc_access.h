@@ -0,0 +1,64 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "picc/rc522_mifare.h"
+
+// {{ access bits
+
+#define PICC_ACCESS_POOL_SIZE          4
+#define PICC_ACCESS_TRAILER_POOL_INDEX 3
+
+typedef struct
+{
+    uint8_t combos[PICC_ACCESS_POOL_SIZE]; // (c1 << 2) | (c2 << 1) | c3 of each access bits pool entry
+} picc_access_bits_t;
+
+/**
+ * Decodes access bits from bytes 6, 7 and 8 of the sector trailer @p trailer_data
+ *
+ * @return ESP_ERR_INVALID_CRC if inverted access bits do not match
+ */
+esp_err_t picc_access_bits_decode(const uint8_t *trailer_data, picc_access_bits_t *out_access_bits);
+
+/**
+ * Index of the access bits pool entry which guards block at @p block_offset
+ * (sectors with more than four blocks share one entry between five data blocks)
+ */
+uint8_t picc_access_pool_index(uint8_t block_offset, uint8_t number_of_blocks);
+
+/**
+ * Key B which is readable from the sector trailer cannot be used for authentication
+ */
+bool picc_access_key_b_usable(const picc_access_bits_t *access_bits);
+
+bool picc_access_key_can_read(const picc_access_bits_t *access_bits,
+    uint8_t block_offset,
+    uint8_t number_of_blocks,
+    rc522_mifare_key_type_t key_type);
+
+// }} access bits
+
+// {{ read planning
+
+typedef struct
+{
+    uint16_t key_blocks; // blocks to read with the key used for the sector authentication
+    uint16_t alt_key_blocks; // blocks to read after authentication with the alternative key
+    uint16_t gaps; // blocks which are not readable with any of provided keys
+} picc_read_plan_t;
+
+/**
+ * Plans the read of data blocks in the sector, trailer is not part of the plan since it is read first
+ * to get the access bits (with the alternative key if key B is readable, see picc_access_key_b_usable()).
+ * Blocks readable with the @p key_type are always read with it, so the alternative key is authenticated
+ * only if some blocks are readable exclusively with it.
+ */
+void picc_access_plan_read(const picc_access_bits_t *access_bits,
+    uint8_t number_of_blocks,
+    rc522_mifare_key_type_t key_type,
+    bool has_alt_key,
+    picc_read_plan_t *out_plan);
+
+// }} read planning
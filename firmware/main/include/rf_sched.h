@@ -0,0 +1,66 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "rc522.h"
+
+// {{ scheduler
+
+typedef enum
+{
+    RF_SCHED_MODE_IDLE = 0, // scanner is resumed only for short windows, every idle interval
+    RF_SCHED_MODE_AGGRESSIVE, // scanner polls continuously at the aggressive interval
+    RF_SCHED_MODE_PAUSED, // scanner is paused while rf batch is in progress
+    RF_SCHED_MODE_MAX,
+} rf_sched_mode_t;
+
+typedef struct
+{
+    rf_sched_mode_t mode;
+    uint32_t interval_ms; // current worst-case card detection latency
+    uint32_t scan_windows; // number of scan windows opened in idle mode
+    uint32_t batches; // number of rf batches which paused polling
+    uint64_t batch_us; // total time spent in rf batches (bus occupied by requests)
+    uint64_t mode_us[RF_SCHED_MODE_MAX]; // total time spent in each mode
+    uint32_t detections; // cards detected by the first poll after the scanner was resumed
+    uint32_t detection_last_us; // measured detection latency, from the resume of the scanner to the detection
+    uint32_t detection_max_us;
+    uint64_t detection_total_us;
+} rf_sched_stats_t;
+
+/**
+ * Creates scheduler task which adapts polling of the @p scanner to the activity.
+ * Scanner needs to be started before calling this function.
+ */
+esp_err_t rf_sched_start(rc522_handle_t scanner);
+
+/**
+ * Card has been removed from the reader, poll aggressively for a while
+ */
+void rf_sched_notify_picc_removed();
+
+/**
+ * Card has been detected. If it was detected by the first poll after the scanner was resumed (so it was
+ * present before), the time since the resume is recorded as detection latency.
+ */
+void rf_sched_notify_picc_detected();
+
+/**
+ * Message from the web client has been received, poll aggressively while client is active
+ */
+void rf_sched_notify_web_activity();
+
+/**
+ * Pauses polling until matching rf_sched_batch_end() so the batch does not contend
+ * with the scanner task for the rc522 task mutex. Calls can be nested.
+ */
+void rf_sched_batch_begin();
+
+void rf_sched_batch_end();
+
+void rf_sched_get_stats(rf_sched_stats_t *out_stats);
+
+const char *rf_sched_mode_name(rf_sched_mode_t mode);
+
+// }} scheduler
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "picc/rc522_mifare.h"
+
+// {{ snapshot store
+
+#define SNAP_STORE_PARTITION_LABEL "snapshots"
+#define SNAP_STORE_UID_SIZE_MAX    10
+#define SNAP_STORE_SECTORS_MAX     40 // Mifare 4K
+#define SNAP_STORE_BLOCKS_MAX      16
+
+typedef struct
+{
+    uint8_t uid[SNAP_STORE_UID_SIZE_MAX];
+    uint8_t uid_length;
+    uint8_t offset; // sector index
+    uint8_t number_of_blocks;
+    uint16_t gaps; // bitmask of blocks which have not been read
+    rc522_mifare_key_t key; // key used to read the sector
+    bool has_alt_key;
+    rc522_mifare_key_t alt_key; // alternative key provided for the read, if has_alt_key
+    uint16_t alt_key_blocks; // bitmask of blocks which were read with the alternative key
+    uint32_t timestamp; // unix time (or uptime in seconds if time is not synced) of the read
+    uint8_t data[SNAP_STORE_BLOCKS_MAX * RC522_MIFARE_BLOCK_SIZE];
+} snap_sector_t;
+
+typedef bool (*snap_store_sector_cb_t)(const snap_sector_t *sector, void *arg);
+
+/**
+ * Mounts the log from the snapshots partition and builds the in-memory index
+ *
+ * @return ESP_ERR_NOT_FOUND if partition does not exist
+ */
+esp_err_t snap_store_init();
+
+/**
+ * Stores the sector, replacing any previous snapshot of the same sector of the same card.
+ * Least recently used cards are evicted if capacity is exceeded.
+ */
+esp_err_t snap_store_put_sector(const snap_sector_t *sector);
+
+/**
+ * @return ESP_ERR_NOT_FOUND if there is no snapshot of the sector
+ */
+esp_err_t snap_store_get_sector(const uint8_t *uid, uint8_t uid_length, uint8_t offset, snap_sector_t *out_sector);
+
+/**
+ * Updates the block in the snapshot of its sector, if sector is stored and the block was read (is not a gap).
+ * Snapshot of the sector is dropped if the sector trailer is written, since keys might have been changed.
+ */
+esp_err_t snap_store_patch_block(const uint8_t *uid, uint8_t uid_length, uint8_t address, const uint8_t *data);
+
+/**
+ * Drops the snapshot of the sector, so it is read from the card next time
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no snapshot of the sector
+ */
+esp_err_t snap_store_drop_sector(const uint8_t *uid, uint8_t uid_length, uint8_t offset);
+
+/**
+ * Calls @p cb for each stored sector of each card, until callback returns false
+ *
+ * @return number of visited sectors
+ */
+uint32_t snap_store_foreach(snap_store_sector_cb_t cb, void *arg);
+
+// }} snapshot store
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "rc522.h"
+#include "picc/rc522_mifare.h"
+
+// {{ trace format
+
+/*
+ * Trace is a header followed by the records, all fields are little-endian.
+ * Every record starts with trace_record_header_t, followed by the payload of the record type.
+ */
+
+#define TRACE_MAGIC   0x5254464E // "NFTR"
+#define TRACE_VERSION 2
+
+typedef enum
+{
+    TRACE_RECORD_MQTT_IN = 1, // payload: inbound message as received
+    TRACE_RECORD_MQTT_OUT, // payload: trace_mqtt_out_t
+    TRACE_RECORD_RF, // payload: trace_rf_t, followed by block data for successful reads and writes
+    TRACE_RECORD_PICC, // payload: trace_picc_t
+} trace_record_type_t;
+
+typedef enum
+{
+    TRACE_RF_AUTH = 1, // address is the block address
+    TRACE_RF_AUTH_SECTOR, // address is the sector index
+    TRACE_RF_READ,
+    TRACE_RF_WRITE,
+    TRACE_RF_DEAUTH,
+} trace_rf_op_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t header_size;
+    uint32_t dropped; // records dropped from the ring because of overflow
+    uint32_t size; // size of the records which follow the header
+} trace_header_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t length; // payload length
+    uint32_t delta_us; // time since the previous record (saturated), record time is the time of the event completion
+} trace_record_header_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t crc; // crc32 of the fields of the message, except $timing (see trace_mqtt_out_digest())
+    uint16_t length; // of the fields the crc is computed of
+} trace_mqtt_out_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t op;
+    uint8_t address;
+    int32_t result;
+    uint32_t duration_us;
+} trace_rf_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t old_state;
+    uint8_t state;
+    uint8_t type;
+    uint8_t sak;
+    uint16_t atqa;
+    uint8_t uid_length;
+    uint8_t uid[RC522_PICC_UID_SIZE_MAX];
+} trace_picc_t;
+
+/**
+ * Digest of the outbound message which the replay matches with. Fields of the top level map are digested
+ * without the map header and $timing, since device timestamps differ on every run and may be disabled
+ * on either side. Message which is not a map is digested whole.
+ */
+void trace_mqtt_out_digest(const uint8_t *data, size_t length, trace_mqtt_out_t *out_digest);
+
+// }} trace format
+
+// {{ recording
+
+/**
+ * Allocates the ring and starts recording
+ */
+esp_err_t trace_init();
+
+/**
+ * Recorders are no-op if trace is not initialized or while it's being dumped
+ */
+void trace_mqtt_in(const uint8_t *data, size_t length);
+
+void trace_mqtt_out(const uint8_t *data, size_t length);
+
+void trace_rf(trace_rf_op_t op, uint8_t address, esp_err_t result, int64_t start_us, const uint8_t *data);
+
+void trace_picc(const rc522_picc_t *picc, rc522_picc_state_t old_state);
+
+// }} recording
+
+// {{ dumping
+
+#define TRACE_CHUNK_SIZE_MAX 768
+
+typedef bool (*trace_chunk_cb_t)(const uint8_t *chunk, size_t length, size_t offset, void *arg);
+
+/**
+ * Calls @p cb with consecutive chunks of the trace (header included) until the whole trace is passed
+ * or callback returns false. Recording is suspended during the dump, and the ring is cleared after
+ * the successful dump, so each dump contains only events after the previous one.
+ *
+ * @param[out] out_size Size of the whole trace
+ * @return ESP_ERR_INVALID_STATE if trace is not initialized
+ */
+esp_err_t trace_dump(trace_chunk_cb_t cb, void *arg, size_t *out_size);
+
+// }} dumping
+
+// {{ rc522 mifare
+
+/*
+ * Wrappers of rc522_mifare_* functions which record the call, its result and duration.
+ */
+
+static inline esp_err_t trace_mifare_auth(
+    rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, const rc522_mifare_key_t *key)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = rc522_mifare_auth(rc522, picc, block_address, key);
+    trace_rf(TRACE_RF_AUTH, block_address, ret, start_us, NULL);
+
+    return ret;
+}
+
+static inline esp_err_t trace_mifare_auth_sector(
+    rc522_handle_t rc522, rc522_picc_t *picc, rc522_mifare_sector_desc_t *sector_desc, const rc522_mifare_key_t *key)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = rc522_mifare_auth_sector(rc522, picc, sector_desc, key);
+    trace_rf(TRACE_RF_AUTH_SECTOR, sector_desc->index, ret, start_us, NULL);
+
+    return ret;
+}
+
+static inline esp_err_t trace_mifare_read(
+    rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, uint8_t *out_buffer)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = rc522_mifare_read(rc522, picc, block_address, out_buffer);
+    trace_rf(TRACE_RF_READ, block_address, ret, start_us, ret == ESP_OK ? out_buffer : NULL);
+
+    return ret;
+}
+
+static inline esp_err_t trace_mifare_write(
+    rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, const uint8_t *buffer)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = rc522_mifare_write(rc522, picc, block_address, buffer);
+    trace_rf(TRACE_RF_WRITE, block_address, ret, start_us, ret == ESP_OK ? buffer : NULL);
+
+    return ret;
+}
+
+static inline esp_err_t trace_mifare_deauth(rc522_handle_t rc522, rc522_picc_t *picc)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = rc522_mifare_deauth(rc522, picc);
+    trace_rf(TRACE_RF_DEAUTH, 0, ret, start_us, NULL);
+
+    return ret;
+}
+
+// }} rc522 mifare
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// {{ transport
+
+/*
+ * Transports carry the CBOR encoded messages between the web clients and the device, all of them
+ * deliver inbound messages to the same receiver. Replies are sent with the transport the request
+ * arrived on, unsolicited messages with all registered transports.
+ */
+
+#define TRANSPORT_COUNT_MAX 4
+
+typedef struct transport_t transport_t;
+
+struct transport_t
+{
+    const char *name;
+    // called from several tasks without a common lock, concurrent sends are serialized by the transport
+    esp_err_t (*send)(const transport_t *transport, const uint8_t *data, size_t length);
+    void *ctx;
+};
+
+/**
+ * Handles the inbound message, called on the task of the transport which received it
+ */
+typedef void (*transport_receiver_t)(const transport_t *transport, const uint8_t *data, size_t length);
+
+esp_err_t transport_register(const transport_t *transport);
+
+void transport_set_receiver(transport_receiver_t receiver);
+
+/**
+ * Passes the inbound message to the receiver, called by transports
+ */
+void transport_receive(const transport_t *transport, const uint8_t *data, size_t length);
+
+/**
+ * Sends the message with @p transport, or with all registered transports if it is NULL
+ *
+ * @return ESP_OK if at least one transport sent the message
+ */
+esp_err_t transport_send(const transport_t *transport, const uint8_t *data, size_t length);
+
+// }} transport
+
+// {{ loopback transport
+
+/**
+ * Receives messages sent with the loopback transport
+ */
+typedef void (*transport_loopback_cb_t)(const uint8_t *data, size_t length, void *arg);
+
+/**
+ * In-process transport which passes sent messages to @p on_sent, so the dispatch can run without network
+ * (e.g. on host). Inbound messages are injected with transport_receive().
+ */
+void transport_loopback_init(transport_t *out_transport, transport_loopback_cb_t on_sent, void *arg);
+
+// }} loopback transport
+
+// {{ websocket transport
+
+#define TRANSPORT_WS_PATH           "/ws"
+#define TRANSPORT_WS_URL_LENGTH_MAX   32 // ws://255.255.255.255:65535/ws
+#define TRANSPORT_WS_TOKEN_LENGTH_MAX 32
+
+/**
+ * Starts the http server with websocket endpoint on the local network, and registers its transport.
+ * Each websocket frame carries one binary message. Clients have to pass @p client_token in the query
+ * of the handshake (?token=...). Replies are sent to the client of the request, other messages to all clients.
+ */
+esp_err_t transport_ws_start(const char *client_token);
+
+/**
+ * Formats url of the endpoint with the current address of the station interface
+ */
+esp_err_t transport_ws_get_url(char *out_url, size_t size);
+
+// }} websocket transport
@@ -1,9 +1,15 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <string.h>
+#include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/semphr.h"
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_rom_crc.h"
+#endif
 #include "esp_wifi.h"
 #include "esp_system.h"
 #include "esp_check.h"
@@ -12,9 +18,16 @@
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "esp_random.h"
+#include "esp_timer.h"
 #include "protocol_examples_common.h"
 #include "mqtt_client.h"
 #include "msg.h"
+#include "rf_sched.h"
+#include "picc_access.h"
+#include "snap_store.h"
+#include "trace.h"
+#include "dlog.h"
+#include "transport.h"
 #include "rc522.h"
 #include "driver/rc522_spi.h"
 #include "picc/rc522_mifare.h"
@@ -24,7 +37,7 @@ extern const uint8_t mqtt_broker_pem_start[] asm("_binary_mqtt_broker_pem_start"
 extern const uint8_t mqtt_broker_pem_end[] asm("_binary_mqtt_broker_pem_end");
 #else
 const uint8_t *mqtt_broker_pem_start = NULL;
-const uint8_t *mqtt_broker_pem_end = mqtt_broker_pem_start;
+const uint8_t *mqtt_broker_pem_end = NULL;
 #endif
 
 #define NVS_NAMESPACE              "nfcity"
@@ -46,6 +59,10 @@ const uint8_t *mqtt_broker_pem_end = mqtt_broker_pem_start;
 
 #define PICC_MEM_BUFFER_SIZE       1024
 
+#define REVERIFY_QUEUE_LENGTH      4
+#define REVERIFY_TASK_STACK_SIZE   4096
+#define REVERIFY_TASK_PRIORITY     2
+
 const char *TAG = "nfcity";
 const char *MSG_LOG_TAG = "nfcity";
 
@@ -62,6 +79,34 @@ static SemaphoreHandle_t enc_buffer_mutex;
 static const uint16_t enc_buffer_mutex_take_timeout_ms = 1000;
 static uint8_t picc_mem_buffer[PICC_MEM_BUFFER_SIZE] = { 0 }; // protect?
 static rc522_picc_t picc = { 0 };
+static snap_sector_t snapshot = { 0 };
+static volatile uint32_t picc_generation = 0; // incremented on every picc state change
+static const transport_t *request_transport = NULL; // transport of the request being handled, under enc_buffer_mutex
+static reply_timing_t request_timing = { 0 }; // timestamps of the request being handled, under enc_buffer_mutex
+
+typedef struct
+{
+    uint32_t picc_generation;
+    rc522_picc_uid_t uid;
+    web_read_sector_msg_t msg;
+    uint16_t gaps;
+    int64_t completed_us; // zero if there is no result to share
+    uint8_t data[SNAP_STORE_BLOCKS_MAX * RC522_MIFARE_BLOCK_SIZE];
+} read_result_t;
+
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+typedef struct
+{
+    uint32_t picc_generation; // of the card the snapshot has been served for
+    uint8_t uid[SNAP_STORE_UID_SIZE_MAX];
+    uint8_t uid_length;
+    web_read_sector_msg_t msg; // keys of the request the snapshot has been served to
+    uint16_t served_gaps;
+    uint32_t served_crc; // of the served data
+} reverify_job_t;
+
+static QueueHandle_t reverify_queue;
+#endif
 
 static rc522_spi_config_t rc522_driver_config = {
     .host_id = SPI3_HOST,
@@ -97,10 +142,42 @@ static mqtt_event_name_map_entry_t mqtt_event_name_map[] = {
 
 static const char *mqtt_event_name(esp_mqtt_event_id_t id);
 
-static esp_err_t read_sector(web_read_sector_msg_t *msg, rc522_mifare_sector_desc_t *sector_desc, uint8_t *buffer);
+static esp_err_t read_sector(web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *buffer,
+    uint16_t *out_gaps,
+    uint16_t *out_alt_key_blocks,
+    reply_timing_t *timing);
 
 static esp_err_t write_block(web_write_block_msg_t *msg, uint8_t *out_buffer);
 
+#ifdef CONFIG_NFCITY_SNAPSHOT_SERVE
+static bool snapshot_lookup(web_read_sector_msg_t *msg, snap_sector_t *out_snapshot);
+#endif
+
+static read_result_t *last_read_result();
+
+static bool last_read_matches(web_read_sector_msg_t *msg);
+
+static void last_read_put(uint32_t generation,
+    web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *buffer,
+    uint16_t gaps);
+
+static void snapshot_put(snap_sector_t *sector,
+    web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *buffer,
+    uint16_t gaps,
+    uint16_t alt_key_blocks);
+
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+static void snapshot_reverify_request(reverify_job_t *job);
+
+static void snapshot_reverify_task(void *arg);
+#endif
+
 // TODO: Check for return values everywhere
 
 static inline char *mqtt_subtopic(const char *subtopic)
@@ -109,10 +186,95 @@ static inline char *mqtt_subtopic(const char *subtopic)
     return mqtt_topic_buffer;
 }
 
-static inline int mqtt_pub(const uint8_t *data, int len, int qos)
+static esp_err_t mqtt_send(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    int msg_id = esp_mqtt_client_publish(
+        mqtt_client, mqtt_subtopic(MQTT_DEV_SUBTOPIC), (const char *)data, length, MQTT_QOS_0, 0);
+
+    return msg_id >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+static const transport_t mqtt_transport = {
+    .name = "mqtt",
+    .send = mqtt_send,
+};
+
+/**
+ * Sends the message with @p transport, or to all clients if it is NULL
+ */
+static inline esp_err_t dev_pub(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    trace_mqtt_out(data, length);
+    return transport_send(transport, data, length);
+}
+
+/**
+ * @return timestamps attached to the reply of the request being handled, NULL if they are disabled
+ */
+static inline const reply_timing_t *reply_timing()
+{
+#ifdef CONFIG_NFCITY_REPLY_TIMING
+    return &request_timing;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @return url of the lan endpoint advertised in hello, NULL if it is not available
+ */
+static const char *lan_url(char *buffer, size_t size)
+{
+#ifdef CONFIG_NFCITY_LAN_ENABLE
+    if (transport_ws_get_url(buffer, size) == ESP_OK) {
+        return buffer;
+    }
+#endif
+
+    return NULL;
+}
+
+// enc_buffer_mutex needs to be held
+static bool on_trace_chunk(const uint8_t *chunk, size_t length, size_t offset, void *arg)
+{
+    enc_frame_t frame = ENC_FRAME_INIT(enc_buffer);
+
+    if (enc_trace_chunk_message((web_msg_t *)arg, &frame, offset, chunk, length) != CborNoError) {
+        return false;
+    }
+
+    return dev_pub(request_transport, frame.buffer, frame.length) == ESP_OK;
+}
+
+// enc_buffer_mutex needs to be held
+static bool on_snapshot_exported(const snap_sector_t *sector, void *arg)
 {
-    return esp_mqtt_client_publish(mqtt_client, mqtt_subtopic(MQTT_DEV_SUBTOPIC), (char *)data, len, qos, 0);
+    enc_frame_t frame = ENC_FRAME_INIT(enc_buffer);
+
+    if (enc_snapshot_message((web_msg_t *)arg, &frame, sector) != CborNoError) {
+        return false;
+    }
+
+    dev_pub(request_transport, frame.buffer, frame.length);
+
+    return true;
+}
+
+#ifdef CONFIG_NFCITY_DLOG_MQTT
+// called by the dlog task, so it has its own buffer and bypasses the trace
+static void on_dlog_batch(const uint8_t *records, size_t size, uint32_t dropped)
+{
+    static uint8_t dlog_enc_buffer[ENC_LOG_SIZE_MAX];
+
+    enc_frame_t frame = ENC_FRAME_INIT(dlog_enc_buffer);
+
+    if (enc_log_message(&frame, records, size, dropped) != CborNoError) {
+        return;
+    }
+
+    mqtt_send(&mqtt_transport, frame.buffer, frame.length);
 }
+#endif
 
 static void on_mqtt_event(void *arg, esp_event_base_t base, int32_t id, void *data)
 {
@@ -132,7 +294,7 @@ static void on_mqtt_event(void *arg, esp_event_base_t base, int32_t id, void *da
             log_level = ESP_LOG_INFO;
         } break;
     }
-    ESP_LOG_LEVEL_LOCAL(log_level,
+    DLOG_LEVEL_LOCAL(log_level,
         TAG,
         "mqtt event (id=%d, name=%s)",
         event->event_id,
@@ -144,120 +306,235 @@ static void on_mqtt_connected(void *arg, esp_event_base_t base, int32_t id, void
     esp_mqtt_client_subscribe_single(mqtt_client, mqtt_subtopic(MQTT_WEB_SUBTOPIC), MQTT_QOS_0);
 
     if (xSemaphoreTake(enc_buffer_mutex, pdMS_TO_TICKS(enc_buffer_mutex_take_timeout_ms)) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to take enc_buffer_mutex");
+        DLOGE(TAG, "Failed to take enc_buffer_mutex");
         return;
     }
 
-    CborEncoder root = { 0 };
-    cbor_encoder_init(&root, enc_buffer, sizeof(enc_buffer), 0);
-    enc_hello_message(&root);
-    size_t enc_length = cbor_encoder_get_buffer_size(&root, enc_buffer);
+    enc_frame_t frame = ENC_FRAME_INIT(enc_buffer);
+    char lan_url_buffer[TRANSPORT_WS_URL_LENGTH_MAX + 1];
+    enc_hello_message(NULL, &frame, lan_url(lan_url_buffer, sizeof(lan_url_buffer)));
 
-    mqtt_pub(enc_buffer, enc_length, MQTT_QOS_0);
+    dev_pub(&mqtt_transport, frame.buffer, frame.length);
 
     if (xSemaphoreGive(enc_buffer_mutex) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to give enc_buffer_mutex");
+        DLOGE(TAG, "Failed to give enc_buffer_mutex");
     }
 
+#ifdef CONFIG_NFCITY_DLOG_MQTT
+    dlog_set_sink(on_dlog_batch);
+#endif
+
     xEventGroupSetBits(wait_bits, MQTT_READY_BIT);
 }
 
+#ifdef CONFIG_NFCITY_DLOG_MQTT
+static void on_mqtt_disconnected(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    dlog_set_sink(NULL);
+}
+#endif
+
 static void on_mqtt_data(void *arg, esp_event_base_t base, int32_t eid, void *data)
 {
     esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)data;
 
+    transport_receive(&mqtt_transport, (const uint8_t *)event->data, event->data_len);
+}
+
+static void on_web_data(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    int64_t rx_us = esp_timer_get_time();
+
+    trace_mqtt_in(data, length);
+
     // decoding request
 
     CborError dec_err = CborNoError;
     web_msg_t web_msg = { 0 };
-    if ((dec_err = dec_msg((uint8_t *)event->data, event->data_len, &web_msg)) != CborNoError) {
-        ESP_LOGE(TAG, "Failed to decode message (dec_err=%d)", dec_err);
+    if ((dec_err = dec_msg(data, length, &web_msg)) != CborNoError) {
+        DLOGE(TAG, "Failed to decode message (dec_err=%d)", dec_err);
         return;
     }
 
-    if (web_msg.kind != WEB_MSG_PING) {
-        ESP_LOGI(TAG, "msg received (kind=%d, id=%s)", web_msg.kind, web_msg.id);
+    rf_sched_notify_web_activity();
+
+    if (web_msg.kind != WEB_MSG_PING && web_msg.kind != WEB_MSG_GET_RF_STATS) { // polled periodically
+        DLOGI(TAG, "msg received (kind=%d, id=%s)", web_msg.kind, web_msg.id);
     }
 
     // encoding response
 
     if (xSemaphoreTake(enc_buffer_mutex, pdMS_TO_TICKS(enc_buffer_mutex_take_timeout_ms)) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to take enc_buffer_mutex");
+        DLOGE(TAG, "Failed to take enc_buffer_mutex, replying busy (id=%s)", web_msg.id);
+        // requests come from several transport tasks, so the client is told instead of waiting for its timeout
+        uint8_t busy_enc_buffer[ENC_ERROR_SIZE_MAX];
+        enc_frame_t busy_frame = ENC_FRAME_INIT(busy_enc_buffer);
+        if (enc_error_message(&web_msg, &busy_frame, ESP_ERR_TIMEOUT, NULL) == CborNoError) {
+            dev_pub(transport, busy_frame.buffer, busy_frame.length);
+        }
         return;
     }
 
-    esp_err_t err = ESP_OK;
-    CborEncoder root = { 0 };
-    size_t enc_length = 0;
+    request_transport = transport;
+    request_timing = (reply_timing_t) { .rx_us = rx_us };
 
-    cbor_encoder_init(&root, enc_buffer, sizeof(enc_buffer), 0);
+    esp_err_t err = ESP_OK;
+    enc_frame_t frame = ENC_FRAME_INIT(enc_buffer);
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+    bool reverify = false;
+    reverify_job_t reverify_job = { 0 };
+#endif
+    bool block_changed = false;
+    web_read_sector_msg_t read_sector_msg = { 0 };
+    web_write_block_msg_t write_block_msg = { 0 };
+    rc522_mifare_sector_desc_t sector_desc = { 0 };
 
     switch (web_msg.kind) {
         case WEB_MSG_PING: {
-            enc_pong_message(&web_msg, &root);
+            enc_pong_message(&web_msg, &frame, reply_timing());
         } break;
         case WEB_MSG_GET_PICC: {
-            enc_picc_message(&web_msg, &root, &picc);
+            enc_picc_message(&web_msg, &frame, &picc);
+        } break;
+        case WEB_MSG_HELLO: {
+            char lan_url_buffer[TRANSPORT_WS_URL_LENGTH_MAX + 1];
+            enc_hello_message(&web_msg, &frame, lan_url(lan_url_buffer, sizeof(lan_url_buffer)));
         } break;
         case WEB_MSG_READ_SECTOR: {
-            web_read_sector_msg_t read_sector_msg = { 0 };
-            dec_read_sector_msg((uint8_t *)event->data, event->data_len, &read_sector_msg);
-            rc522_mifare_sector_desc_t sector_desc = { 0 };
+            if ((dec_err = dec_read_sector_msg(data, length, &read_sector_msg)) != CborNoError) {
+                DLOGE(TAG, "Failed to decode read_sector message (dec_err=%d)", dec_err);
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
             rc522_mifare_get_sector_desc(read_sector_msg.offset, &sector_desc);
-            if ((err = read_sector(&read_sector_msg, &sector_desc, picc_mem_buffer)) == ESP_OK) {
-                enc_picc_sector_message(&web_msg, &root, &sector_desc, picc_mem_buffer);
+            uint16_t gaps = 0;
+            uint16_t alt_key_blocks = 0;
+            if (last_read_matches(&read_sector_msg)) {
+                DLOGD(TAG, "sharing result of the last read of sector %d", sector_desc.index);
+                read_result_t *last_read = last_read_result();
+                enc_picc_sector_message(
+                    &web_msg, &frame, &sector_desc, last_read->data, last_read->gaps, reply_timing());
+                break;
+            }
+#ifdef CONFIG_NFCITY_SNAPSHOT_SERVE
+            if (snapshot_lookup(&read_sector_msg, &snapshot)) {
+                DLOGD(TAG, "serving sector %d from snapshot", sector_desc.index);
+                memcpy(picc_mem_buffer, snapshot.data, sector_desc.number_of_blocks * RC522_MIFARE_BLOCK_SIZE);
+                enc_picc_sector_message(
+                    &web_msg, &frame, &sector_desc, picc_mem_buffer, snapshot.gaps, reply_timing());
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+                reverify = true;
+                reverify_job.picc_generation = picc_generation;
+                memcpy(reverify_job.uid, snapshot.uid, snapshot.uid_length);
+                reverify_job.uid_length = snapshot.uid_length;
+                memcpy(&reverify_job.msg, &read_sector_msg, sizeof(reverify_job.msg));
+                reverify_job.served_gaps = snapshot.gaps;
+                reverify_job.served_crc = esp_rom_crc32_le(
+                    0, picc_mem_buffer, sector_desc.number_of_blocks * RC522_MIFARE_BLOCK_SIZE);
+#endif
+                break;
+            }
+#endif
+            uint32_t generation = picc_generation;
+            if ((err = read_sector(
+                     &read_sector_msg, &sector_desc, picc_mem_buffer, &gaps, &alt_key_blocks, &request_timing))
+                == ESP_OK) {
+                last_read_put(generation, &read_sector_msg, &sector_desc, picc_mem_buffer, gaps);
+                snapshot_put(&snapshot, &read_sector_msg, &sector_desc, picc_mem_buffer, gaps, alt_key_blocks);
+                enc_picc_sector_message(&web_msg, &frame, &sector_desc, picc_mem_buffer, gaps, reply_timing());
             }
         } break;
         case WEB_MSG_WRITE_BLOCK: {
-            web_write_block_msg_t write_block_msg = { 0 };
-            dec_write_block_msg((uint8_t *)event->data, event->data_len, &write_block_msg);
+            if ((dec_err = dec_write_block_msg(data, length, &write_block_msg)) != CborNoError) {
+                DLOGE(TAG, "Failed to decode write_block message (dec_err=%d)", dec_err);
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
             if ((err = write_block(&write_block_msg, picc_mem_buffer)) == ESP_OK) {
-                enc_picc_block_message(&web_msg, &root, write_block_msg.address, picc_mem_buffer);
+                snap_store_patch_block(picc.uid.value, picc.uid.length, write_block_msg.address, picc_mem_buffer);
+                enc_picc_block_message(&web_msg, &frame, write_block_msg.address, picc_mem_buffer, reply_timing());
+#ifdef CONFIG_NFCITY_BROADCAST_BLOCK_CHANGES
+                block_changed = true;
+#endif
+            }
+        } break;
+        case WEB_MSG_GET_SNAPSHOTS: {
+            uint32_t count = snap_store_foreach(on_snapshot_exported, &web_msg);
+            enc_snapshots_message(&web_msg, &frame, count);
+        } break;
+        case WEB_MSG_GET_TRACE: {
+            size_t size = 0;
+            if ((err = trace_dump(on_trace_chunk, &web_msg, &size)) == ESP_OK) {
+                enc_trace_message(&web_msg, &frame, size);
             }
         } break;
+        case WEB_MSG_GET_RF_STATS: {
+            rf_sched_stats_t rf_stats = { 0 };
+            rf_sched_get_stats(&rf_stats);
+            enc_rf_stats_message(&web_msg, &frame, &rf_stats);
+        } break;
         default: {
-            ESP_LOGW(TAG, "Unsupported meessage kind: %d", web_msg.kind);
+            DLOGW(TAG, "Unsupported meessage kind: %d", web_msg.kind);
             err = ESP_ERR_NOT_SUPPORTED;
         } break;
     }
 
     if (err != ESP_OK) {
-        enc_error_message(&web_msg, &root, err);
+        enc_error_message(&web_msg, &frame, err, reply_timing());
     }
 
-    enc_length = cbor_encoder_get_buffer_size(&root, enc_buffer);
+    if (frame.length > 0) {
+        dev_pub(request_transport, frame.buffer, frame.length);
+    }
 
-    if (enc_length > 0) {
-        mqtt_pub(enc_buffer, enc_length, MQTT_QOS_0);
+    if (block_changed) { // writer got its response, let everyone else know
+        if (enc_picc_block_changed_message(&frame, &picc, write_block_msg.address, picc_mem_buffer) == CborNoError) {
+            dev_pub(NULL, frame.buffer, frame.length);
+        }
     }
 
     if (xSemaphoreGive(enc_buffer_mutex) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to give enc_buffer_mutex");
+        DLOGE(TAG, "Failed to give enc_buffer_mutex");
+    }
+
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+    if (reverify) { // response is already sent, the card is read in the background
+        snapshot_reverify_request(&reverify_job);
     }
+#endif
 }
 
 static void on_picc_state_changed(void *arg, esp_event_base_t base, int32_t event_id, void *data)
 {
     rc522_picc_state_changed_event_t *event = (rc522_picc_state_changed_event_t *)data;
 
-    ESP_LOGD(TAG, "picc state changed from %d to %d", event->old_state, event->picc->state);
+    DLOGD(TAG, "picc state changed from %d to %d", event->old_state, event->picc->state);
 
     memcpy(&picc, event->picc, sizeof(rc522_picc_t));
+    picc_generation++;
+    trace_picc(&picc, event->old_state);
+
+    if (picc.state == RC522_PICC_STATE_ACTIVE && event->old_state == RC522_PICC_STATE_IDLE) {
+        rf_sched_notify_picc_detected();
+    }
+
+    if (picc.state == RC522_PICC_STATE_IDLE
+        && (event->old_state == RC522_PICC_STATE_ACTIVE || event->old_state == RC522_PICC_STATE_ACTIVE_H)) {
+        rf_sched_notify_picc_removed();
+    }
 
     if (xSemaphoreTake(enc_buffer_mutex, pdMS_TO_TICKS(enc_buffer_mutex_take_timeout_ms)) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to take enc_buffer_mutex");
+        DLOGE(TAG, "Failed to take enc_buffer_mutex");
         return;
     }
 
-    CborEncoder root = { 0 };
-    cbor_encoder_init(&root, enc_buffer, sizeof(enc_buffer), 0);
-    enc_picc_state_changed_message(&root, &picc, event->old_state);
-    size_t enc_length = cbor_encoder_get_buffer_size(&root, enc_buffer);
+    enc_frame_t frame = ENC_FRAME_INIT(enc_buffer);
+    enc_picc_state_changed_message(&frame, &picc, event->old_state);
 
-    mqtt_pub(enc_buffer, enc_length, MQTT_QOS_0);
+    dev_pub(NULL, frame.buffer, frame.length);
 
     if (xSemaphoreGive(enc_buffer_mutex) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to give enc_buffer_mutex");
+        DLOGE(TAG, "Failed to give enc_buffer_mutex");
     }
 }
 
@@ -272,74 +549,490 @@ static const char *mqtt_event_name(esp_mqtt_event_id_t id)
     return "unknown";
 }
 
-static esp_err_t read_sector(web_read_sector_msg_t *msg, rc522_mifare_sector_desc_t *sector_desc, uint8_t *buffer)
+/**
+ * Reads blocks marked in @p blocks bitmask, with already authenticated key.
+ * Failed read breaks the authentication, so the rest of the blocks are not read.
+ *
+ * @return bitmask of blocks which have not been read
+ */
+static uint16_t read_sector_blocks(rc522_mifare_sector_desc_t *sector_desc, uint16_t blocks, uint8_t *buffer)
+{
+    for (uint8_t i = 0; i < sector_desc->number_of_blocks; i++) {
+        uint16_t block_bit = 1 << i;
+
+        if ((blocks & block_bit) == 0) {
+            continue;
+        }
+
+        uint8_t block_addr = sector_desc->block_0_address + i;
+        uint8_t *buffer_ptr = buffer + (i * RC522_MIFARE_BLOCK_SIZE);
+
+        if (trace_mifare_read(rc522_scanner, &picc, block_addr, buffer_ptr) != ESP_OK) {
+            DLOGW(TAG, "read of block %d failed", block_addr);
+            return blocks & ~(block_bit - 1);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Authenticates with @p key and reads blocks marked in @p blocks bitmask, nothing is done if it is empty
+ *
+ * @return bitmask of blocks which have not been read
+ */
+static uint16_t read_sector_blocks_with(
+    rc522_mifare_sector_desc_t *sector_desc, rc522_mifare_key_t *key, uint16_t blocks, uint8_t *buffer)
+{
+    if (blocks == 0) {
+        return 0;
+    }
+
+    if (trace_mifare_auth_sector(rc522_scanner, &picc, sector_desc, key) != ESP_OK) {
+        DLOGW(TAG, "auth of sector %d with key %d failed", sector_desc->index, key->type);
+        return blocks;
+    }
+
+    return read_sector_blocks(sector_desc, blocks, buffer);
+}
+
+/**
+ * Reads blocks marked in @p blocks bitmask one by one with @p key, authenticating again after each failed read
+ *
+ * @return bitmask of blocks which have not been read
+ */
+static uint16_t read_sector_blocks_each(
+    rc522_mifare_sector_desc_t *sector_desc, rc522_mifare_key_t *key, uint16_t blocks, uint8_t *buffer)
+{
+    uint16_t gaps = 0;
+    bool authenticated = false;
+
+    for (uint8_t i = 0; i < sector_desc->number_of_blocks; i++) {
+        uint16_t block_bit = 1 << i;
+
+        if ((blocks & block_bit) == 0) {
+            continue;
+        }
+
+        if (!authenticated && trace_mifare_auth_sector(rc522_scanner, &picc, sector_desc, key) != ESP_OK) {
+            return gaps | (blocks & ~(block_bit - 1));
+        }
+
+        authenticated = read_sector_blocks(sector_desc, block_bit, buffer) == 0;
+        gaps |= authenticated ? 0 : block_bit;
+    }
+
+    return gaps;
+}
+
+/**
+ * Reads data blocks as planned from the access bits of the trailer, which is already read to @p buffer
+ *
+ * @param alt_key_session sector is authenticated with @p alt_key (trailer was read with it), not with @p key
+ * @param out_alt_key_blocks bitmask of blocks which have been read with @p alt_key
+ * @return bitmask of blocks which have not been read
+ */
+static uint16_t read_sector_planned(web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    rc522_mifare_key_t *key,
+    rc522_mifare_key_t *alt_key,
+    bool alt_key_session,
+    uint8_t *buffer,
+    uint16_t *out_alt_key_blocks)
+{
+    uint8_t trailer_offset = sector_desc->number_of_blocks - 1;
+    picc_access_bits_t access_bits = { 0 };
+    picc_read_plan_t plan = { 0 };
+
+    if (picc_access_bits_decode(buffer + (trailer_offset * RC522_MIFARE_BLOCK_SIZE), &access_bits) == ESP_OK) {
+        picc_access_plan_read(&access_bits, sector_desc->number_of_blocks, key->type, msg->has_alt_key, &plan);
+    }
+    else {
+        DLOGW(TAG, "access bits integrity violated, reading all blocks with provided key");
+        plan.key_blocks = (1 << trailer_offset) - 1;
+    }
+
+    uint16_t key_gaps = 0;
+    uint16_t alt_key_gaps = 0;
+
+    // blocks of the key of the current authentication are read first, to save one authentication
+    if (alt_key_session) {
+        alt_key_gaps = read_sector_blocks(sector_desc, plan.alt_key_blocks, buffer);
+        key_gaps = read_sector_blocks_with(sector_desc, key, plan.key_blocks, buffer);
+    }
+    else {
+        key_gaps = read_sector_blocks(sector_desc, plan.key_blocks, buffer);
+        alt_key_gaps = read_sector_blocks_with(sector_desc, alt_key, plan.alt_key_blocks, buffer);
+    }
+
+    *out_alt_key_blocks = plan.alt_key_blocks & ~alt_key_gaps;
+    return plan.gaps | key_gaps | alt_key_gaps;
+}
+
+/**
+ * @param out_alt_key_blocks bitmask of blocks which have been read with the alternative key, since they are not
+ * readable with the key (trailer included)
+ * @param timing card access is recorded to, if not NULL
+ */
+static esp_err_t read_sector(web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *buffer,
+    uint16_t *out_gaps,
+    uint16_t *out_alt_key_blocks,
+    reply_timing_t *timing)
 {
     if (picc.state != RC522_PICC_STATE_ACTIVE && picc.state != RC522_PICC_STATE_ACTIVE_H) {
-        ESP_LOGW(TAG, "cannot read memory. picc is not active");
+        DLOGW(TAG, "cannot read memory. picc is not active");
         return ESP_FAIL;
     }
 
+    rf_sched_batch_begin();
+
     if (xSemaphoreTake(rc522_task_mutex, pdMS_TO_TICKS(rc522_task_mutex_take_timeout_ms)) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to take rc522_task_mutex");
+        DLOGE(TAG, "Failed to take rc522_task_mutex");
+        rf_sched_batch_end();
         return ESP_FAIL;
     }
 
+    if (timing != NULL) {
+        timing->rf_start_us = esp_timer_get_time();
+    }
+
     rc522_mifare_key_t key = {
         .type = msg->key.type,
     };
 
     memcpy(key.value, msg->key.value, RC522_MIFARE_KEY_SIZE);
 
+    rc522_mifare_key_t alt_key = {
+        .type = msg->alt_key.type,
+    };
+
+    memcpy(alt_key.value, msg->alt_key.value, RC522_MIFARE_KEY_SIZE);
+
     esp_err_t ret = ESP_OK;
 
-    ESP_GOTO_ON_ERROR(rc522_mifare_auth_sector(rc522_scanner, &picc, sector_desc, &key), _exit, TAG, "auth failed");
+    uint8_t trailer_offset = sector_desc->number_of_blocks - 1;
+    uint16_t trailer_bit = 1 << trailer_offset;
+    uint16_t gaps = 0;
+    uint16_t alt_key_blocks = 0;
 
-    for (uint8_t i = 0; i < sector_desc->number_of_blocks; i++) {
-        uint8_t block_addr = sector_desc->block_0_address + i;
-        uint8_t *buffer_ptr = buffer + (i * RC522_MIFARE_BLOCK_SIZE);
+    DLOG_GOTO_ON_ERROR(trace_mifare_auth_sector(rc522_scanner, &picc, sector_desc, &key), _exit, TAG, "auth failed");
+
+    // trailer is read first to plan the rest. Its access bits are readable with any key which authenticates,
+    // except key B while key B itself is readable (access bits 000, 010 and 001): the card accepts the key,
+    // but denies every access, which is the case the alternative key is for
+    bool alt_key_session = false;
+    bool trailer_read = read_sector_blocks(sector_desc, trailer_bit, buffer) == 0;
+
+    if (!trailer_read && msg->has_alt_key) {
+        DLOGD(TAG, "trailer of sector %d is not readable with the key, trying alternative key", sector_desc->index);
+        alt_key_session = trace_mifare_auth_sector(rc522_scanner, &picc, sector_desc, &alt_key) == ESP_OK;
+        trailer_read = alt_key_session && read_sector_blocks(sector_desc, trailer_bit, buffer) == 0;
+    }
+
+    if (trailer_read) {
+        gaps = read_sector_planned(msg, sector_desc, &key, &alt_key, alt_key_session, buffer, &alt_key_blocks);
+        alt_key_blocks |= alt_key_session ? trailer_bit : 0;
+    }
+    else { // nothing to plan with, so every block is tried
+        DLOGW(TAG, "trailer of sector %d is not readable, reading blocks one by one", sector_desc->index);
+        gaps = trailer_bit | read_sector_blocks_each(sector_desc, &key, trailer_bit - 1, buffer);
+
+        if (gaps == (trailer_bit | (trailer_bit - 1))) {
+            DLOGE(TAG, "no block of sector %d is readable", sector_desc->index);
+            ret = ESP_FAIL;
+            goto _exit;
+        }
+    }
 
-        ESP_GOTO_ON_ERROR(rc522_mifare_read(rc522_scanner, &picc, block_addr, buffer_ptr), _exit, TAG, "read failed");
+    for (uint8_t i = 0; i <= trailer_offset; i++) {
+        if (gaps & (1 << i)) {
+            memset(buffer + (i * RC522_MIFARE_BLOCK_SIZE), 0, RC522_MIFARE_BLOCK_SIZE);
+        }
     }
+
+    *out_gaps = gaps;
+    *out_alt_key_blocks = alt_key_blocks;
 _exit:
-    rc522_mifare_deauth(rc522_scanner, &picc);
+    trace_mifare_deauth(rc522_scanner, &picc);
+    if (timing != NULL) {
+        timing->rf_end_us = esp_timer_get_time();
+    }
     xSemaphoreGive(rc522_task_mutex);
+    rf_sched_batch_end();
 
     return ret;
 }
 
+static inline bool msg_picc_key_equals(const msg_picc_key_t *a, const msg_picc_key_t *b)
+{
+    return a->type == b->type && memcmp(a->value, b->value, RC522_MIFARE_KEY_SIZE) == 0;
+}
+
+static inline bool msg_picc_key_equals_rc522(const msg_picc_key_t *a, const rc522_mifare_key_t *b)
+{
+    return a->type == b->type && memcmp(a->value, b->value, RC522_MIFARE_KEY_SIZE) == 0;
+}
+
+/**
+ * Result of the last sector read, shared by requests of all transports.
+ * enc_buffer_mutex needs to be held while it is read or updated.
+ */
+static read_result_t *last_read_result()
+{
+    static read_result_t last_read = { 0 };
+    return &last_read;
+}
+
+/**
+ * Keeps the result of the read of the card of @p generation, to share it. enc_buffer_mutex needs to be held.
+ */
+static void last_read_put(uint32_t generation,
+    web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *buffer,
+    uint16_t gaps)
+{
+    if (sector_desc->number_of_blocks > SNAP_STORE_BLOCKS_MAX) {
+        return;
+    }
+
+    read_result_t *last_read = last_read_result();
+    last_read->picc_generation = generation;
+    memcpy(&last_read->uid, &picc.uid, sizeof(last_read->uid));
+    memcpy(&last_read->msg, msg, sizeof(last_read->msg));
+    last_read->gaps = gaps;
+    memcpy(last_read->data, buffer, sector_desc->number_of_blocks * RC522_MIFARE_BLOCK_SIZE);
+    last_read->completed_us = esp_timer_get_time();
+}
+
+/**
+ * Requests which waited for enc_buffer_mutex while the read was in progress get its result,
+ * instead of the next RF transaction. enc_buffer_mutex needs to be held.
+ */
+static bool last_read_matches(web_read_sector_msg_t *msg)
+{
+#if CONFIG_NFCITY_READ_COALESCE_WINDOW_MS > 0
+    read_result_t *last_read = last_read_result();
+
+    if (last_read->completed_us == 0 || last_read->picc_generation != picc_generation) {
+        return false;
+    }
+
+    if (esp_timer_get_time() - last_read->completed_us > (int64_t)CONFIG_NFCITY_READ_COALESCE_WINDOW_MS * 1000) {
+        return false;
+    }
+
+    if (last_read->uid.length != picc.uid.length
+        || memcmp(last_read->uid.value, picc.uid.value, picc.uid.length) != 0) {
+        return false;
+    }
+
+    return last_read->msg.offset == msg->offset && msg_picc_key_equals(&last_read->msg.key, &msg->key)
+        && last_read->msg.has_alt_key == msg->has_alt_key
+        && (!msg->has_alt_key || msg_picc_key_equals(&last_read->msg.alt_key, &msg->alt_key));
+#else
+    return false;
+#endif
+}
+
 static esp_err_t write_block(web_write_block_msg_t *msg, uint8_t *out_buffer)
 {
     esp_err_t ret = ESP_OK;
 
     if (picc.state != RC522_PICC_STATE_ACTIVE && picc.state != RC522_PICC_STATE_ACTIVE_H) {
-        ESP_LOGW(TAG, "cannot write memory. picc is not active");
+        DLOGW(TAG, "cannot write memory. picc is not active");
         return ESP_FAIL;
     }
+    rf_sched_batch_begin();
     if (xSemaphoreTake(rc522_task_mutex, pdMS_TO_TICKS(rc522_task_mutex_take_timeout_ms)) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to take rc522_task_mutex");
+        DLOGE(TAG, "Failed to take rc522_task_mutex");
+        rf_sched_batch_end();
         return ESP_FAIL;
     }
+    request_timing.rf_start_us = esp_timer_get_time();
     rc522_mifare_key_t key = {
         .type = msg->key.type,
     };
     memcpy(key.value, msg->key.value, RC522_MIFARE_KEY_SIZE);
 
-    ESP_GOTO_ON_ERROR(rc522_mifare_auth(rc522_scanner, &picc, msg->address, &key), _exit, TAG, "auth failed");
-    ESP_GOTO_ON_ERROR(rc522_mifare_write(rc522_scanner, &picc, msg->address, msg->data), _exit, TAG, "write failed");
+    DLOG_GOTO_ON_ERROR(trace_mifare_auth(rc522_scanner, &picc, msg->address, &key), _exit, TAG, "auth failed");
+    last_read_result()->completed_us = 0; // content might change even if the write fails
+    DLOG_GOTO_ON_ERROR(trace_mifare_write(rc522_scanner, &picc, msg->address, msg->data), _exit, TAG, "write failed");
     uint8_t verification_buffer[RC522_MIFARE_BLOCK_SIZE] = { 0 };
-    ESP_GOTO_ON_ERROR(rc522_mifare_read(rc522_scanner, &picc, msg->address, verification_buffer),
+    DLOG_GOTO_ON_ERROR(trace_mifare_read(rc522_scanner, &picc, msg->address, verification_buffer),
         _exit,
         TAG,
         "read failed");
     memcpy(out_buffer, verification_buffer, RC522_MIFARE_BLOCK_SIZE);
 
 _exit:
-    rc522_mifare_deauth(rc522_scanner, &picc);
+    trace_mifare_deauth(rc522_scanner, &picc);
+    request_timing.rf_end_us = esp_timer_get_time();
     xSemaphoreGive(rc522_task_mutex);
+    rf_sched_batch_end();
 
     return ret;
 }
 
+#ifdef CONFIG_NFCITY_SNAPSHOT_SERVE
+static bool snapshot_lookup(web_read_sector_msg_t *msg, snap_sector_t *out_snapshot)
+{
+    if (picc.state != RC522_PICC_STATE_ACTIVE && picc.state != RC522_PICC_STATE_ACTIVE_H) {
+        return false;
+    }
+
+    if (snap_store_get_sector(picc.uid.value, picc.uid.length, msg->offset, out_snapshot) != ESP_OK) {
+        return false;
+    }
+
+    // snapshot read with a different key might have different gaps or be made with a key which is no longer valid
+    if (!msg_picc_key_equals_rc522(&msg->key, &out_snapshot->key)) {
+        return false;
+    }
+
+    if (msg->has_alt_key) { // served as is if it was read with the same keys, alternative key might fill the gaps
+        return out_snapshot->has_alt_key ? msg_picc_key_equals_rc522(&msg->alt_key, &out_snapshot->alt_key)
+                                         : out_snapshot->gaps == 0 && out_snapshot->alt_key_blocks == 0;
+    }
+
+    // blocks read with the alternative key are not served to requesters which have not provided it
+    uint16_t blocks = (1 << out_snapshot->number_of_blocks) - 1;
+    uint16_t masked = out_snapshot->alt_key_blocks & ~out_snapshot->gaps;
+
+    if ((out_snapshot->gaps | masked) == blocks) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < out_snapshot->number_of_blocks; i++) {
+        if (masked & (1 << i)) {
+            memset(out_snapshot->data + (i * RC522_MIFARE_BLOCK_SIZE), 0, RC522_MIFARE_BLOCK_SIZE);
+        }
+    }
+
+    out_snapshot->gaps |= masked;
+    out_snapshot->alt_key_blocks = 0;
+
+    return true;
+}
+#endif
+
+/**
+ * Fills @p sector with the read and stores it. @p sector is either snapshot, under enc_buffer_mutex,
+ * or owned by the caller.
+ */
+static void snapshot_put(snap_sector_t *sector,
+    web_read_sector_msg_t *msg,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *buffer,
+    uint16_t gaps,
+    uint16_t alt_key_blocks)
+{
+    if (picc.uid.length > SNAP_STORE_UID_SIZE_MAX || sector_desc->number_of_blocks > SNAP_STORE_BLOCKS_MAX) {
+        return;
+    }
+
+    memset(sector, 0, sizeof(*sector));
+    memcpy(sector->uid, picc.uid.value, picc.uid.length);
+    sector->uid_length = picc.uid.length;
+    sector->offset = sector_desc->index;
+    sector->number_of_blocks = sector_desc->number_of_blocks;
+    sector->gaps = gaps;
+    sector->key.type = msg->key.type;
+    memcpy(sector->key.value, msg->key.value, RC522_MIFARE_KEY_SIZE);
+    sector->has_alt_key = msg->has_alt_key;
+    sector->alt_key.type = msg->alt_key.type;
+    memcpy(sector->alt_key.value, msg->alt_key.value, RC522_MIFARE_KEY_SIZE);
+    sector->alt_key_blocks = alt_key_blocks;
+    sector->timestamp = (uint32_t)time(NULL);
+    memcpy(sector->data, buffer, sector_desc->number_of_blocks * RC522_MIFARE_BLOCK_SIZE);
+
+    esp_err_t err = snap_store_put_sector(sector);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        DLOGW(TAG, "Failed to store snapshot of sector %d (err=%d)", sector->offset, err);
+    }
+}
+
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+// {{ snapshot re-verification
+
+/**
+ * Hands a served snapshot over to the re-verification task. Must not be called with enc_buffer_mutex held.
+ */
+static void snapshot_reverify_request(reverify_job_t *job)
+{
+    if (xQueueSend(reverify_queue, job, 0) != pdTRUE) { // sector is re-verified by a later request
+        DLOGD(TAG, "re-verification queue is full, skipping sector %d", job->msg.offset);
+    }
+}
+
+/**
+ * Reads the sector of @p job again and publishes it, if it differs from the served snapshot.
+ * The card is read under rc522_task_mutex only, enc_buffer_mutex is taken to publish the update.
+ */
+static void snapshot_reverify(reverify_job_t *job, snap_sector_t *sector, uint8_t *buffer)
+{
+    rc522_mifare_sector_desc_t sector_desc = { 0 };
+    rc522_mifare_get_sector_desc(job->msg.offset, &sector_desc);
+    uint16_t gaps = 0;
+    uint16_t alt_key_blocks = 0;
+
+    if (job->picc_generation != picc_generation) { // card of the snapshot is gone
+        return;
+    }
+
+    esp_err_t err = read_sector(&job->msg, &sector_desc, buffer, &gaps, &alt_key_blocks, NULL);
+
+    if (job->picc_generation != picc_generation) { // card has changed during the read
+        return;
+    }
+
+    if (err != ESP_OK) { // served data can't be vouched for
+        DLOGW(TAG, "re-verification of sector %d failed, dropping snapshot", sector_desc.index);
+        snap_store_drop_sector(job->uid, job->uid_length, job->msg.offset);
+        return;
+    }
+
+    size_t sector_size = sector_desc.number_of_blocks * RC522_MIFARE_BLOCK_SIZE;
+    if (gaps == job->served_gaps && esp_rom_crc32_le(0, buffer, sector_size) == job->served_crc) {
+        return;
+    }
+
+    DLOGI(TAG, "sector %d differs from snapshot, publishing update", sector_desc.index);
+    snapshot_put(sector, &job->msg, &sector_desc, buffer, gaps, alt_key_blocks);
+
+    if (xSemaphoreTake(enc_buffer_mutex, pdMS_TO_TICKS(enc_buffer_mutex_take_timeout_ms)) != pdTRUE) {
+        DLOGE(TAG, "Failed to take enc_buffer_mutex, update of sector %d is not published", sector_desc.index);
+        return;
+    }
+
+    enc_frame_t frame = ENC_FRAME_INIT(enc_buffer);
+    if (enc_picc_sector_message(NULL, &frame, &sector_desc, buffer, gaps, NULL) == CborNoError) {
+        dev_pub(NULL, frame.buffer, frame.length);
+    }
+
+    if (xSemaphoreGive(enc_buffer_mutex) != pdTRUE) {
+        DLOGE(TAG, "Failed to give enc_buffer_mutex");
+    }
+}
+
+static void snapshot_reverify_task(void *arg)
+{
+    static snap_sector_t sector = { 0 };
+    static uint8_t buffer[SNAP_STORE_BLOCKS_MAX * RC522_MIFARE_BLOCK_SIZE] = { 0 };
+    reverify_job_t job = { 0 };
+
+    for (;;) {
+        if (xQueueReceive(reverify_queue, &job, portMAX_DELAY) == pdTRUE) {
+            snapshot_reverify(&job, &sector, buffer);
+        }
+    }
+}
+
+// }}
+#endif
+
 void app_main()
 {
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -356,6 +1049,46 @@ void app_main()
         assert(rc522_task_mutex != NULL);
     }
 
+#ifdef CONFIG_NFCITY_DLOG_ENABLE
+    { // deferred logging
+        esp_err_t dlog_err = dlog_init();
+        if (dlog_err != ESP_OK) {
+            ESP_LOGW(TAG, "deferred logging is not available (err=%d)", dlog_err);
+        }
+    }
+#endif
+
+#ifdef CONFIG_NFCITY_TRACE_ENABLE
+    { // trace
+        esp_err_t trace_err = trace_init();
+        if (trace_err != ESP_OK) {
+            ESP_LOGW(TAG, "trace is not available (err=%d)", trace_err);
+        }
+    }
+#endif
+
+#ifdef CONFIG_NFCITY_SNAPSHOT_ENABLE
+    { // snapshots
+        esp_err_t snap_err = snap_store_init();
+        if (snap_err != ESP_OK) {
+            ESP_LOGW(TAG, "snapshot store is not available (err=%d)", snap_err);
+        }
+#ifdef CONFIG_NFCITY_SNAPSHOT_REVERIFY
+        else {
+            reverify_queue = xQueueCreate(REVERIFY_QUEUE_LENGTH, sizeof(reverify_job_t));
+            assert(reverify_queue != NULL);
+            BaseType_t task_created = xTaskCreate(snapshot_reverify_task,
+                "snap_reverify",
+                REVERIFY_TASK_STACK_SIZE,
+                NULL,
+                REVERIFY_TASK_PRIORITY,
+                NULL);
+            assert(task_created == pdPASS);
+        }
+#endif
+    }
+#endif
+
     { // wifi
         ESP_ERROR_CHECK(example_connect());
     }
@@ -410,13 +1143,31 @@ void app_main()
         mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
         assert(mqtt_client != NULL);
 
+        transport_set_receiver(on_web_data);
+        ESP_ERROR_CHECK(transport_register(&mqtt_transport));
+
         ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, on_mqtt_event, NULL));
         ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, MQTT_EVENT_CONNECTED, on_mqtt_connected, NULL));
         ESP_ERROR_CHECK(esp_mqtt_client_register_event(mqtt_client, MQTT_EVENT_DATA, on_mqtt_data, NULL));
+#ifdef CONFIG_NFCITY_DLOG_MQTT
+        ESP_ERROR_CHECK(
+            esp_mqtt_client_register_event(mqtt_client, MQTT_EVENT_DISCONNECTED, on_mqtt_disconnected, NULL));
+#endif
 
         ESP_ERROR_CHECK(esp_mqtt_client_start(mqtt_client));
     }
 
+#ifdef CONFIG_NFCITY_LAN_ENABLE
+    { // lan
+        char lan_token[MQTT_ROOT_TOPIC_LENGTH + 1] = { 0 }; // clients know the root topic, as the one of the broker
+        memcpy(lan_token, mqtt_topic_buffer + 1, MQTT_ROOT_TOPIC_LENGTH);
+        esp_err_t lan_err = transport_ws_start(lan_token);
+        if (lan_err != ESP_OK) {
+            ESP_LOGW(TAG, "lan transport is not available (err=%d)", lan_err);
+        }
+    }
+#endif
+
     { // rc522
         xEventGroupWaitBits(wait_bits, MQTT_READY_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
 
@@ -426,11 +1177,13 @@ void app_main()
         rc522_config_t rc522_scanner_config = {
             .driver = rc522_driver,
             .task_mutex = rc522_task_mutex,
+            .poll_interval_ms = CONFIG_NFCITY_RF_POLL_AGGRESSIVE_INTERVAL_MS,
         };
 
         ESP_ERROR_CHECK(rc522_create(&rc522_scanner_config, &rc522_scanner));
         ESP_ERROR_CHECK(
             rc522_register_events(rc522_scanner, RC522_EVENT_PICC_STATE_CHANGED, on_picc_state_changed, NULL));
         ESP_ERROR_CHECK(rc522_start(rc522_scanner));
+        ESP_ERROR_CHECK(rf_sched_start(rc522_scanner));
     }
 }
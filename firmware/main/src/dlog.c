@@ -0,0 +1,533 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_check.h"
+#include "dlog.h"
+
+#ifdef CONFIG_NFCITY_DLOG_ENABLE
+
+/*
+ * Each core has its own ring, so producers never contend across cores. Space for a record is
+ * reserved with interrupts masked on the current core (no context switch, so no migration either),
+ * and the record is copied and committed after unmasking. Task consumes committed records
+ * in order and stops at the first one which is still being written.
+ */
+
+#define DLOG_TASK_STACK_SIZE 3072
+#define DLOG_TASK_PRIORITY   1
+#define DLOG_RING_SIZE       (CONFIG_NFCITY_DLOG_RING_SIZE & ~3)
+#define DLOG_LINE_LENGTH     256
+#define DLOG_SPEC_LENGTH_MAX 16
+
+static const char *TAG = "dlog";
+
+typedef enum
+{
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_SIZE,
+    ARG_INTMAX,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_POINTER,
+    ARG_STRING,
+    ARG_UNSUPPORTED,
+} arg_kind_t;
+
+typedef struct
+{
+    const char *start; // points to '%'
+    size_t length;
+    arg_kind_t kind;
+} conversion_t;
+
+typedef struct
+{
+    const char *format;
+    const char *tag;
+    uint32_t timestamp_ms;
+    uint8_t level;
+    uint8_t reserved;
+    uint16_t args_size;
+} entry_t; // followed by args
+
+typedef enum
+{
+    SLOT_RESERVED = 1,
+    SLOT_COMMITTED,
+    SLOT_WRAP, // rest of the ring is unused, next slot is at the beginning
+} slot_state_t;
+
+typedef struct
+{
+    uint8_t state;
+    uint8_t reserved;
+    uint16_t size; // including this header
+} slot_t; // followed by entry
+
+typedef struct
+{
+    uint8_t *buffer;
+    size_t head; // bytes reserved so far, written with interrupts masked on the core of the ring
+    size_t tail; // bytes consumed so far, written by the task
+    uint32_t dropped;
+} ring_t;
+
+static ring_t rings[portNUM_PROCESSORS];
+static TaskHandle_t task;
+static dlog_sink_t sink;
+static uint8_t batch[DLOG_BATCH_SIZE_MAX];
+static size_t batch_size;
+
+static const char level_letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+// {{ format
+
+/**
+ * Finds the next conversion in @p format
+ *
+ * @return pointer past the conversion, or NULL if there are no more conversions
+ */
+static const char *next_conversion(const char *format, conversion_t *out_conversion)
+{
+    const char *ptr = format;
+
+    while ((ptr = strchr(ptr, '%')) != NULL) {
+        const char *start = ptr++;
+
+        if (*ptr == '%') {
+            ptr++;
+            continue;
+        }
+
+        arg_kind_t kind = ARG_INT;
+
+        ptr += strspn(ptr, "-+ #0");
+        if (*ptr == '*') {
+            kind = ARG_UNSUPPORTED;
+        }
+        ptr += strspn(ptr, "*0123456789");
+        if (*ptr == '.') {
+            ptr++;
+            if (*ptr == '*') {
+                kind = ARG_UNSUPPORTED;
+            }
+            ptr += strspn(ptr, "*0123456789");
+        }
+
+        arg_kind_t int_kind = ARG_INT;
+
+        switch (*ptr) {
+            case 'h': {
+                ptr += ptr[1] == 'h' ? 2 : 1;
+            } break;
+            case 'l': {
+                int_kind = ptr[1] == 'l' ? ARG_LONG_LONG : ARG_LONG;
+                ptr += ptr[1] == 'l' ? 2 : 1;
+            } break;
+            case 'z': {
+                int_kind = ARG_SIZE;
+                ptr++;
+            } break;
+            case 'j': {
+                int_kind = ARG_INTMAX;
+                ptr++;
+            } break;
+            case 't': {
+                int_kind = ARG_PTRDIFF;
+                ptr++;
+            } break;
+            case 'L': { // long double
+                kind = ARG_UNSUPPORTED;
+                ptr++;
+            } break;
+        }
+
+        if (*ptr == '\0') {
+            out_conversion->start = start;
+            out_conversion->length = ptr - start;
+            out_conversion->kind = ARG_UNSUPPORTED;
+            return ptr;
+        }
+
+        if (kind != ARG_UNSUPPORTED) {
+            if (strchr("diouxXc", *ptr) != NULL) {
+                kind = int_kind;
+            }
+            else if (strchr("fFeEgGaA", *ptr) != NULL) {
+                kind = ARG_DOUBLE;
+            }
+            else if (*ptr == 's') {
+                kind = ARG_STRING;
+            }
+            else if (*ptr == 'p') {
+                kind = ARG_POINTER;
+            }
+            else {
+                kind = ARG_UNSUPPORTED;
+            }
+        }
+
+        out_conversion->start = start;
+        out_conversion->length = ptr + 1 - start;
+        out_conversion->kind = kind;
+
+        return ptr + 1;
+    }
+
+    return NULL;
+}
+
+#define ARGS_PUT(type)                                                                                                 \
+    {                                                                                                                  \
+        type value = va_arg(args, type);                                                                               \
+        if (size + sizeof(value) > DLOG_ARGS_SIZE_MAX) {                                                               \
+            return size;                                                                                               \
+        }                                                                                                              \
+        memcpy(out_args + size, &value, sizeof(value));                                                                \
+        size += sizeof(value);                                                                                         \
+    }
+
+/**
+ * @return size of encoded arguments, arguments which don't fit (or follow unsupported conversion) are dropped
+ */
+static size_t args_encode(const char *format, va_list args, uint8_t *out_args)
+{
+    conversion_t conversion;
+    size_t size = 0;
+
+    while ((format = next_conversion(format, &conversion)) != NULL) {
+        switch (conversion.kind) {
+            case ARG_INT: ARGS_PUT(int) break;
+            case ARG_LONG: ARGS_PUT(long) break;
+            case ARG_LONG_LONG: ARGS_PUT(long long) break;
+            case ARG_SIZE: ARGS_PUT(size_t) break;
+            case ARG_INTMAX: ARGS_PUT(intmax_t) break;
+            case ARG_PTRDIFF: ARGS_PUT(ptrdiff_t) break;
+            case ARG_DOUBLE: ARGS_PUT(double) break;
+            case ARG_POINTER: ARGS_PUT(void *) break;
+            case ARG_STRING: {
+                const char *str = va_arg(args, const char *);
+                str = str != NULL ? str : "(null)";
+                size_t length = strnlen(str, DLOG_STRING_LENGTH_MAX);
+                if (size + 1 + length > DLOG_ARGS_SIZE_MAX) {
+                    return size;
+                }
+                out_args[size++] = length;
+                memcpy(out_args + size, str, length);
+                size += length;
+            } break;
+            case ARG_UNSUPPORTED:
+            default: {
+                return size; // type of the argument is not known, so neither are the following ones
+            }
+        }
+    }
+
+    return size;
+}
+
+#define ARGS_GET(type)                                                                                                 \
+    {                                                                                                                  \
+        type value;                                                                                                    \
+        if (offset + sizeof(value) > args_size) {                                                                      \
+            goto _missing;                                                                                             \
+        }                                                                                                              \
+        memcpy(&value, args + offset, sizeof(value));                                                                  \
+        offset += sizeof(value);                                                                                       \
+        length += snprintf(out + length, out_size - length, spec, value);                                              \
+    }
+
+/**
+ * Formats the message of the record, conversions without arguments are printed as they are
+ */
+static void args_format(const char *format, const uint8_t *args, size_t args_size, char *out, size_t out_size)
+{
+    conversion_t conversion;
+    char spec[DLOG_SPEC_LENGTH_MAX];
+    char str[DLOG_STRING_LENGTH_MAX + 1];
+    size_t offset = 0;
+    size_t length = 0;
+
+    while (length < out_size - 1) {
+        const char *next = next_conversion(format, &conversion);
+        const char *literal_end = next != NULL ? conversion.start : format + strlen(format);
+
+        for (; format < literal_end && length < out_size - 1; format++) {
+            out[length++] = *format;
+            if (format[0] == '%' && format[1] == '%') {
+                format++;
+            }
+        }
+
+        if (next == NULL || length >= out_size - 1) {
+            break;
+        }
+
+        format = next;
+
+        if (conversion.kind == ARG_UNSUPPORTED || conversion.length >= sizeof(spec)) {
+            goto _missing;
+        }
+
+        memcpy(spec, conversion.start, conversion.length);
+        spec[conversion.length] = '\0';
+
+        switch (conversion.kind) {
+            case ARG_INT: ARGS_GET(int) break;
+            case ARG_LONG: ARGS_GET(long) break;
+            case ARG_LONG_LONG: ARGS_GET(long long) break;
+            case ARG_SIZE: ARGS_GET(size_t) break;
+            case ARG_INTMAX: ARGS_GET(intmax_t) break;
+            case ARG_PTRDIFF: ARGS_GET(ptrdiff_t) break;
+            case ARG_DOUBLE: ARGS_GET(double) break;
+            case ARG_POINTER: ARGS_GET(void *) break;
+            case ARG_STRING: {
+                if (offset + 1 > args_size || offset + 1 + args[offset] > args_size) {
+                    goto _missing;
+                }
+                memcpy(str, args + offset + 1, args[offset]);
+                str[args[offset]] = '\0';
+                offset += 1 + args[offset];
+                length += snprintf(out + length, out_size - length, spec, str);
+            } break;
+            default: {
+                goto _missing;
+            }
+        }
+
+        length = length < out_size - 1 ? length : out_size - 1;
+        continue;
+
+    _missing:
+        offset = args_size; // following arguments can't be located
+        length += snprintf(out + length, out_size - length, "%.*s", (int)conversion.length, conversion.start);
+        length = length < out_size - 1 ? length : out_size - 1;
+    }
+
+    out[length] = '\0';
+}
+
+static void entry_emit_text(const entry_t *entry, const uint8_t *args)
+{
+    char line[DLOG_LINE_LENGTH];
+    args_format(entry->format, args, entry->args_size, line, sizeof(line));
+
+    esp_log_write(entry->level,
+        entry->tag,
+        "%c (%" PRIu32 ") %s: %s\n",
+        level_letters[entry->level],
+        entry->timestamp_ms,
+        entry->tag,
+        line);
+}
+
+// }} format
+
+// {{ sink
+
+static void batch_flush(uint32_t dropped)
+{
+    dlog_sink_t batch_sink = __atomic_load_n(&sink, __ATOMIC_ACQUIRE);
+
+    if (batch_sink != NULL && (batch_size > 0 || dropped > 0)) {
+        batch_sink(batch, batch_size, dropped);
+    }
+
+    batch_size = 0;
+}
+
+static void entry_emit_raw(const entry_t *entry, const uint8_t *args, uint8_t core)
+{
+    dlog_record_t record = {
+        .format = (uint32_t)(uintptr_t)entry->format,
+        .tag = (uint32_t)(uintptr_t)entry->tag,
+        .timestamp_ms = entry->timestamp_ms,
+        .level = entry->level,
+        .core = core,
+        .args_size = entry->args_size,
+    };
+
+    if (batch_size + sizeof(record) + record.args_size > sizeof(batch)) {
+        batch_flush(0);
+    }
+
+    memcpy(batch + batch_size, &record, sizeof(record));
+    memcpy(batch + batch_size + sizeof(record), args, record.args_size);
+    batch_size += sizeof(record) + record.args_size;
+}
+
+// }} sink
+
+// {{ ring
+
+static inline size_t align4(size_t size)
+{
+    return (size + 3) & ~(size_t)3;
+}
+
+static void ring_push(const entry_t *entry, const uint8_t *args)
+{
+    size_t slot_size = align4(sizeof(slot_t) + sizeof(entry_t) + entry->args_size);
+    slot_t *slot = NULL;
+
+    UBaseType_t interrupts = portSET_INTERRUPT_MASK_FROM_ISR();
+    ring_t *ring = &rings[xPortGetCoreID()];
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t position = ring->head % DLOG_RING_SIZE;
+    size_t pad = position + slot_size > DLOG_RING_SIZE ? DLOG_RING_SIZE - position : 0;
+    size_t used = ring->head - tail;
+
+    if (DLOG_RING_SIZE - used >= pad + slot_size) {
+        if (pad > 0) {
+            slot_t *wrap = (slot_t *)(ring->buffer + position);
+            wrap->size = pad;
+            wrap->state = SLOT_WRAP;
+            position = 0;
+        }
+        slot = (slot_t *)(ring->buffer + position);
+        slot->size = slot_size;
+        slot->state = SLOT_RESERVED;
+        used += pad + slot_size;
+        __atomic_store_n(&ring->head, ring->head + pad + slot_size, __ATOMIC_RELEASE);
+    }
+    else {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(interrupts);
+
+    if (slot == NULL) {
+        return;
+    }
+
+    memcpy(slot + 1, entry, sizeof(entry_t));
+    memcpy((uint8_t *)(slot + 1) + sizeof(entry_t), args, entry->args_size);
+    __atomic_store_n(&slot->state, SLOT_COMMITTED, __ATOMIC_RELEASE);
+
+    if (used > DLOG_RING_SIZE / 2) {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void ring_drain(ring_t *ring, uint8_t core, bool raw)
+{
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    while (ring->tail != head) {
+        slot_t *slot = (slot_t *)(ring->buffer + (ring->tail % DLOG_RING_SIZE));
+        uint8_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+
+        if (state == SLOT_RESERVED) { // being written, records are consumed in order
+            break;
+        }
+
+        if (state == SLOT_COMMITTED) {
+            entry_t entry;
+            memcpy(&entry, slot + 1, sizeof(entry));
+            const uint8_t *args = (uint8_t *)(slot + 1) + sizeof(entry);
+
+            if (raw) {
+                entry_emit_raw(&entry, args, core);
+            }
+            else {
+                entry_emit_text(&entry, args);
+            }
+        }
+
+        __atomic_store_n(&ring->tail, ring->tail + slot->size, __ATOMIC_RELEASE);
+    }
+}
+
+// }} ring
+
+// {{ task
+
+static void dlog_task(void *arg)
+{
+    uint32_t dropped_reported = 0;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_NFCITY_DLOG_FLUSH_INTERVAL_MS));
+
+        bool raw = __atomic_load_n(&sink, __ATOMIC_ACQUIRE) != NULL;
+        uint32_t dropped = 0;
+
+        for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+            ring_drain(&rings[core], core, raw);
+            dropped += __atomic_load_n(&rings[core].dropped, __ATOMIC_RELAXED);
+        }
+
+        if (raw) {
+            batch_flush(dropped - dropped_reported);
+        }
+        else if (dropped != dropped_reported) {
+            ESP_LOGW(TAG, "%" PRIu32 " records dropped, rings are full", dropped - dropped_reported);
+        }
+
+        dropped_reported = dropped;
+    }
+}
+
+esp_err_t dlog_init()
+{
+    ESP_RETURN_ON_FALSE(task == NULL, ESP_ERR_INVALID_STATE, TAG, "already initialized");
+
+    for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+        rings[core].buffer = malloc(DLOG_RING_SIZE);
+        ESP_RETURN_ON_FALSE(rings[core].buffer != NULL, ESP_ERR_NO_MEM, TAG, "no mem for ring");
+    }
+
+    if (xTaskCreate(dlog_task, "dlog", DLOG_TASK_STACK_SIZE, NULL, DLOG_TASK_PRIORITY, &task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+// }} task
+
+void dlog_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    uint8_t args[DLOG_ARGS_SIZE_MAX];
+
+    entry_t entry = {
+        .format = format,
+        .tag = tag,
+        .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .level = level,
+    };
+
+    va_list va_args;
+    va_start(va_args, format);
+    entry.args_size = args_encode(format, va_args, args);
+    va_end(va_args);
+
+    if (task == NULL) { // not initialized yet
+        entry_emit_text(&entry, args);
+        return;
+    }
+
+    ring_push(&entry, args);
+}
+
+void dlog_set_sink(dlog_sink_t new_sink)
+{
+    __atomic_store_n(&sink, new_sink, __ATOMIC_RELEASE);
+}
+
+#else // messages are formatted synchronously by the DLOG macros
+
+esp_err_t dlog_init()
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void dlog_set_sink(dlog_sink_t new_sink) { }
+
+#endif
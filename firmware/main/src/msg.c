@@ -1,43 +1,57 @@
+#include <string.h>
+#include "esp_timer.h"
 #include "msg.h"
+#include "trace.h"
+#include "transport.h"
+
+// bounds of the schema need to cover the firmware buffers
+_Static_assert(MSG_PICC_UID_LENGTH_MAX >= RC522_PICC_UID_SIZE_MAX, "uid does not fit the schema");
+_Static_assert(MSG_PICC_BLOCK_DATA_LENGTH == RC522_MIFARE_BLOCK_SIZE, "block size mismatch");
+_Static_assert(MSG_PICC_KEY_VALUE_LENGTH == RC522_MIFARE_KEY_SIZE, "key size mismatch");
+_Static_assert(DEC_WRITE_BLOCK_DATA_LENGTH == RC522_MIFARE_BLOCK_SIZE, "block size mismatch");
+_Static_assert(ENC_PICC_BLOCK_DATA_LENGTH == RC522_MIFARE_BLOCK_SIZE, "block size mismatch");
+_Static_assert(ENC_PICC_BLOCK_CHANGED_DATA_LENGTH == RC522_MIFARE_BLOCK_SIZE, "block size mismatch");
+_Static_assert(ENC_PICC_SECTOR_BLOCKS_COUNT_MAX >= SNAP_STORE_BLOCKS_MAX, "sector does not fit the schema");
+_Static_assert(ENC_SNAPSHOT_UID_LENGTH_MAX >= SNAP_STORE_UID_SIZE_MAX, "uid does not fit the schema");
+_Static_assert(ENC_SNAPSHOT_BLOCKS_COUNT_MAX >= SNAP_STORE_BLOCKS_MAX, "sector does not fit the schema");
+_Static_assert(ENC_TRACE_CHUNK_DATA_LENGTH_MAX >= TRACE_CHUNK_SIZE_MAX, "trace chunk does not fit the schema");
+_Static_assert(ENC_LOG_RECORDS_LENGTH_MAX >= DLOG_BATCH_SIZE_MAX, "log batch does not fit the schema");
+_Static_assert(DLOG_STRING_LENGTH_MAX >= MSG_ID_LENGTH_MAX, "message ids are truncated in logs");
+_Static_assert(DLOG_ARGS_SIZE_MAX >= 2 * (1 + DLOG_STRING_LENGTH_MAX) + 2 * sizeof(int),
+    "arguments of CBOR_RETCHECK logs do not fit");
+_Static_assert(ENC_HELLO_LAN_LENGTH_MAX >= TRANSPORT_WS_URL_LENGTH_MAX, "lan url does not fit the schema");
 
 // {{ decoding
 
-struct
+CborError dec_uint(const CborValue *value, uint64_t max, uint64_t *out_result)
 {
-    const char *kind_str;
-    web_msg_kind_t kind;
-} static web_msg_kind_map[] = {
-    { "ping", WEB_MSG_PING },
-    { "get_picc", WEB_MSG_GET_PICC },
-    { "read_sector", WEB_MSG_READ_SECTOR },
-    { "write_block", WEB_MSG_WRITE_BLOCK },
-};
-
-static void dec_map_kind(const char *kind_str, web_msg_kind_t *out_kind)
-{
-    uint8_t entry_count = sizeof(web_msg_kind_map) / sizeof(web_msg_kind_map[0]);
+    uint64_t result;
 
-    for (uint8_t i = 0; i < entry_count; i++) {
-        if (strcmp(kind_str, web_msg_kind_map[i].kind_str) == 0) {
-            *out_kind = web_msg_kind_map[i].kind;
-            return;
-        }
-    }
+    CBOR_RETCHECK(cbor_value_is_unsigned_integer(value), CborErrorIllegalType);
+    CBOR_ERRCHECK(cbor_value_get_uint64(value, &result));
+    CBOR_RETCHECK(result <= max, CborErrorDataTooLarge);
 
-    *out_kind = WEB_MSG_UNKNOWN;
+    *out_result = result;
+    return CborNoError;
 }
 
-static CborError cbor_value_get_uint8(CborValue *value, uint8_t *out_result)
+CborError dec_byte_string(const CborValue *value, uint8_t *out_data, size_t length)
 {
-    uint64_t result;
+    size_t len = 0;
 
-    CBOR_ERRCHECK(cbor_value_get_uint64(value, &result));
-    CBOR_RETCHECK(result <= UINT8_MAX, CborErrorDataTooLarge);
+    CBOR_RETCHECK(cbor_value_is_byte_string(value), CborErrorIllegalType);
+    CBOR_ERRCHECK(cbor_value_get_string_length(value, &len));
+    CBOR_RETCHECK(len == length, CborErrorUnknownLength);
+    CBOR_ERRCHECK(cbor_value_copy_byte_string(value, out_data, &len, NULL));
 
-    *out_result = (uint8_t)result;
     return CborNoError;
 }
 
+bool dec_is_present(const CborValue *value)
+{
+    return cbor_value_is_valid(value) && !cbor_value_is_null(value) && !cbor_value_is_undefined(value);
+}
+
 CborError dec_msg(const uint8_t *buffer, size_t buffer_size, web_msg_t *out_msg)
 {
     web_msg_t msg = { 0 };
@@ -52,51 +66,28 @@ CborError dec_msg(const uint8_t *buffer, size_t buffer_size, web_msg_t *out_msg)
     CBOR_ERRCHECK(cbor_value_get_string_length(&value, &len));
     CBOR_RETCHECK(len <= sizeof(msg.id) - 1, CborErrorOverlongEncoding);
     CBOR_ERRCHECK(cbor_value_copy_text_string(&value, msg.id, &len, NULL));
-    char kind_str[32] = { 0 };
     CBOR_ERRCHECK(cbor_value_map_find_value(&it, MSG_KIND_FIELD, &value));
     CBOR_RETCHECK(cbor_value_is_text_string(&value), CborErrorIllegalType);
     CBOR_ERRCHECK(cbor_value_get_string_length(&value, &len));
-    CBOR_RETCHECK(len <= sizeof(kind_str) - 1, CborErrorOverlongEncoding);
-    CBOR_ERRCHECK(cbor_value_copy_text_string(&value, kind_str, &len, NULL));
-    dec_map_kind(kind_str, &msg.kind);
+    if (len > MSG_KIND_LENGTH_MAX) { // cannot be any of the known kinds
+        msg.kind = WEB_MSG_UNKNOWN;
+    }
+    else {
+        char kind_str[MSG_KIND_LENGTH_MAX + 1] = { 0 };
+        CBOR_ERRCHECK(cbor_value_copy_text_string(&value, kind_str, &len, NULL));
+        msg.kind = msg_dec_kind(kind_str);
+    }
 
     memcpy(out_msg, &msg, sizeof(msg));
     return CborNoError;
 }
 
-static CborError dec_picc_key(const CborValue *key_map, msg_picc_key_t *out_key)
-{
-    msg_picc_key_t key = { 0 };
-
-    CborValue value;
-    CBOR_ERRCHECK(cbor_value_map_find_value(key_map, "value", &value));
-    CBOR_RETCHECK(cbor_value_is_byte_string(&value), CborErrorIllegalType);
-    size_t len = 0;
-    CBOR_ERRCHECK(cbor_value_get_string_length(&value, &len));
-    CBOR_RETCHECK(len == RC522_MIFARE_KEY_SIZE, CborErrorUnknownLength);
-    CBOR_ERRCHECK(cbor_value_copy_byte_string(&value, key.value, &len, NULL));
-    CBOR_ERRCHECK(cbor_value_map_find_value(key_map, "type", &value));
-    CBOR_RETCHECK(cbor_value_is_unsigned_integer(&value), CborErrorIllegalType);
-    CBOR_ERRCHECK(cbor_value_get_uint8(&value, (uint8_t *)&key.type));
-
-    memcpy(out_key, &key, sizeof(key));
-    return CborNoError;
-}
-
 CborError dec_read_sector_msg(const uint8_t *buffer, size_t buffer_size, web_read_sector_msg_t *out_read_sector_msg)
 {
     web_read_sector_msg_t msg = { 0 };
 
-    CborParser parser;
-    CborValue it;
-    CBOR_ERRCHECK(cbor_parser_init(buffer, buffer_size, 0, &parser, &it));
-    CborValue value;
-    CBOR_ERRCHECK(cbor_value_map_find_value(&it, "offset", &value));
-    CBOR_RETCHECK(cbor_value_is_unsigned_integer(&value), CborErrorIllegalType);
-    CBOR_ERRCHECK(cbor_value_get_uint8(&value, &msg.offset));
-    CBOR_ERRCHECK(cbor_value_map_find_value(&it, MSG_KEY_FIELD, &value));
-    CBOR_RETCHECK(cbor_value_is_map(&value), CborErrorIllegalType);
-    CBOR_ERRCHECK(dec_picc_key(&value, &msg.key));
+    CBOR_ERRCHECK(msg_dec_read_sector(buffer, buffer_size, &msg));
+    CBOR_RETCHECK(!msg.has_alt_key || msg.alt_key.type != msg.key.type, CborErrorImproperValue);
 
     memcpy(out_read_sector_msg, &msg, sizeof(msg));
     return CborNoError;
@@ -104,206 +95,223 @@ CborError dec_read_sector_msg(const uint8_t *buffer, size_t buffer_size, web_rea
 
 CborError dec_write_block_msg(const uint8_t *buffer, size_t buffer_size, web_write_block_msg_t *out_write_block_msg)
 {
-    web_write_block_msg_t msg = { 0 };
-
-    CborParser parser;
-    CborValue it;
-    CBOR_ERRCHECK(cbor_parser_init(buffer, buffer_size, 0, &parser, &it));
-    CborValue value;
-    CBOR_ERRCHECK(cbor_value_map_find_value(&it, "address", &value));
-    CBOR_RETCHECK(cbor_value_is_unsigned_integer(&value), CborErrorIllegalType);
-    CBOR_ERRCHECK(cbor_value_get_uint8(&value, &msg.address));
-    CBOR_ERRCHECK(cbor_value_map_find_value(&it, "data", &value));
-    CBOR_RETCHECK(cbor_value_is_byte_string(&value), CborErrorIllegalType);
-    size_t len = 0;
-    CBOR_ERRCHECK(cbor_value_get_string_length(&value, &len));
-    CBOR_RETCHECK(len == RC522_MIFARE_BLOCK_SIZE, CborErrorUnknownLength);
-    CBOR_ERRCHECK(cbor_value_copy_byte_string(&value, msg.data, &len, NULL));
-    CBOR_ERRCHECK(cbor_value_map_find_value(&it, MSG_KEY_FIELD, &value));
-    CBOR_RETCHECK(cbor_value_is_map(&value), CborErrorIllegalType);
-    CBOR_ERRCHECK(dec_picc_key(&value, &msg.key));
-
-    memcpy(out_write_block_msg, &msg, sizeof(msg));
-    return CborNoError;
+    return msg_dec_write_block(buffer, buffer_size, out_write_block_msg);
 }
 
 // }} decoding
 
 // {{ encoding
 
-#define ENC_KIND_LEN 1
-static CborError enc_kind(CborEncoder *encoder, const char *kind)
+CborError enc_frame_begin(enc_frame_t *frame,
+    const uint8_t *prefix,
+    size_t prefix_length,
+    uint8_t optional_count,
+    CborEncoder *out_encoder)
 {
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, MSG_KIND_FIELD));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, kind));
-
-    return CborNoError;
-}
+    frame->length = 0;
 
-#define ENC_CTX_LEN     1
-#define ENC_CTX_MAP_LEN 1
-static CborError enc_ctx(CborEncoder *encoder, web_msg_t *ctx)
-{
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, MSG_CTX_FIELD));
+    CBOR_RETCHECK(prefix_length <= frame->size, CborErrorOutOfMemory);
 
-    CborEncoder ctx_map;
+    memcpy(frame->buffer, prefix, prefix_length);
+    frame->buffer[0] += optional_count;
 
-    CBOR_ERRCHECK(cbor_encoder_create_map(encoder, &ctx_map, ENC_CTX_MAP_LEN));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&ctx_map, MSG_ID_FIELD));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&ctx_map, ctx->id));
-    CBOR_ERRCHECK(cbor_encoder_close_container(encoder, &ctx_map));
+    // rest of the message map is encoded as the top level items following the prefix
+    cbor_encoder_init(out_encoder, frame->buffer + prefix_length, frame->size - prefix_length, 0);
 
     return CborNoError;
 }
 
-CborError enc_hello_message(CborEncoder *root)
+CborError enc_frame_end(enc_frame_t *frame, const CborEncoder *encoder)
 {
-    CborEncoder message_map;
-
-    CBOR_ERRCHECK(cbor_encoder_create_map(root, &message_map, ENC_KIND_LEN));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_HELLO_MSG_KIND));
-    CBOR_ERRCHECK(cbor_encoder_close_container(root, &message_map));
+    frame->length = cbor_encoder_get_buffer_size(encoder, frame->buffer);
 
     return CborNoError;
 }
 
-CborError enc_error_message(web_msg_t *ctx, CborEncoder *encoder, int64_t error_code)
+static void enc_picc_from(const rc522_picc_t *picc, enc_picc_t *out_picc)
 {
-    CborEncoder message_map;
+    out_picc->state = picc->state;
+    out_picc->uid = picc->uid.length == 0 ? NULL : picc->uid.value;
+    out_picc->uid_length = picc->uid.length;
+    out_picc->type = picc->type;
+    out_picc->atqa = picc->atqa.source;
+    out_picc->sak = picc->sak;
+}
 
-    size_t message_map_len = ENC_KIND_LEN + 1;
-    if (ctx != NULL) {
-        message_map_len += ENC_CTX_LEN;
+static void enc_picc_blocks_from(uint8_t block_0_address,
+    uint8_t number_of_blocks,
+    const uint8_t *sector_data,
+    uint16_t gaps,
+    enc_picc_block_t *out_blocks)
+{
+    for (uint8_t i = 0; i < number_of_blocks; i++) {
+        out_blocks[i].address = block_0_address + i;
+        out_blocks[i].data = (gaps & (1 << i)) ? NULL : sector_data + (i * RC522_MIFARE_BLOCK_SIZE);
     }
-    CBOR_ERRCHECK(cbor_encoder_create_map(encoder, &message_map, message_map_len));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_ERROR_MSG_KIND));
-    if (ctx != NULL) {
-        CBOR_ERRCHECK(enc_ctx(&message_map, ctx));
+}
+
+/**
+ * @return @p out_timing, or NULL if there is no @p timing to attach
+ */
+static const enc_timing_t *enc_timing_from(
+    const reply_timing_t *timing, int64_t now_us, enc_timing_t *out_timing, enc_timing_span_t *out_rf)
+{
+    if (timing == NULL) {
+        return NULL;
     }
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&message_map, "code"));
-    CBOR_ERRCHECK(cbor_encode_int(&message_map, error_code));
-    CBOR_ERRCHECK(cbor_encoder_close_container(encoder, &message_map));
 
-    return CborNoError;
+    out_timing->rx = timing->rx_us;
+    out_timing->rf = NULL;
+    out_timing->tx = now_us - timing->rx_us;
+
+    if (timing->rf_start_us != 0) {
+        out_rf->start = timing->rf_start_us - timing->rx_us;
+        out_rf->end = timing->rf_end_us - timing->rx_us;
+        out_timing->rf = out_rf;
+    }
+
+    return out_timing;
 }
 
-CborError enc_pong_message(web_msg_t *ctx, CborEncoder *encoder)
+CborError enc_hello_message(web_msg_t *ctx, enc_frame_t *frame, const char *lan_url)
 {
-    CborEncoder message_map;
+    return msg_enc_hello(frame, ctx, lan_url);
+}
 
-    CBOR_ERRCHECK(cbor_encoder_create_map(encoder, &message_map, ENC_KIND_LEN + ENC_CTX_LEN));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_PONG_MSG_KIND));
-    CBOR_ERRCHECK(enc_ctx(&message_map, ctx));
-    CBOR_ERRCHECK(cbor_encoder_close_container(encoder, &message_map));
+CborError enc_error_message(web_msg_t *ctx, enc_frame_t *frame, int64_t error_code, const reply_timing_t *timing)
+{
+    enc_timing_t enc_timing = { 0 };
+    enc_timing_span_t enc_rf = { 0 };
 
-    return CborNoError;
+    return msg_enc_error(
+        frame, ctx, error_code, enc_timing_from(timing, esp_timer_get_time(), &enc_timing, &enc_rf));
 }
 
-#define ENC_PICC_LEN 5
-static CborError enc_picc(CborEncoder *encoder, rc522_picc_t *picc)
+CborError enc_pong_message(web_msg_t *ctx, enc_frame_t *frame, const reply_timing_t *timing)
 {
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "state"));
-    CBOR_ERRCHECK(cbor_encode_int(encoder, picc->state));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "uid"));
-    if (picc->uid.length == 0) {
-        CBOR_ERRCHECK(cbor_encode_null(encoder));
-    }
-    else {
-        CBOR_ERRCHECK(cbor_encode_byte_string(encoder, picc->uid.value, picc->uid.length));
-    }
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "type"));
-    CBOR_ERRCHECK(cbor_encode_int(encoder, picc->type));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "atqa"));
-    CBOR_ERRCHECK(cbor_encode_uint(encoder, picc->atqa.source));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "sak"));
-    CBOR_ERRCHECK(cbor_encode_uint(encoder, picc->sak));
+    enc_timing_t enc_timing = { 0 };
+    enc_timing_span_t enc_rf = { 0 };
 
-    return CborNoError;
+    return msg_enc_pong(frame, ctx, enc_timing_from(timing, esp_timer_get_time(), &enc_timing, &enc_rf));
 }
 
-CborError enc_picc_message(web_msg_t *ctx, CborEncoder *root, rc522_picc_t *picc)
+CborError enc_picc_message(web_msg_t *ctx, enc_frame_t *frame, rc522_picc_t *picc)
 {
-    CborEncoder message_map;
-
-    CBOR_ERRCHECK(cbor_encoder_create_map(root, &message_map, ENC_KIND_LEN + ENC_CTX_LEN + 1));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_PICC_MSG_KIND));
-    CBOR_ERRCHECK(enc_ctx(&message_map, ctx));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&message_map, "picc"));
-    CborEncoder picc_map;
-    CBOR_ERRCHECK(cbor_encoder_create_map(&message_map, &picc_map, ENC_PICC_LEN));
-    CBOR_ERRCHECK(enc_picc(&picc_map, picc));
-    CBOR_ERRCHECK(cbor_encoder_close_container(&message_map, &picc_map));
-    CBOR_ERRCHECK(cbor_encoder_close_container(root, &message_map));
+    enc_picc_t enc_picc = { 0 };
+    enc_picc_from(picc, &enc_picc);
 
-    return CborNoError;
+    return msg_enc_picc(frame, ctx, &enc_picc);
 }
 
-CborError enc_picc_state_changed_message(CborEncoder *root, rc522_picc_t *picc, rc522_picc_state_t old_state)
+CborError enc_picc_state_changed_message(enc_frame_t *frame, rc522_picc_t *picc, rc522_picc_state_t old_state)
 {
-    CborEncoder message_map;
-
-    CBOR_ERRCHECK(cbor_encoder_create_map(root, &message_map, ENC_KIND_LEN + 2));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_PICC_STATE_CHANGED_MSG_KIND));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&message_map, "old_state"));
-    CBOR_ERRCHECK(cbor_encode_int(&message_map, old_state));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&message_map, "picc"));
-    CborEncoder picc_map;
-    CBOR_ERRCHECK(cbor_encoder_create_map(&message_map, &picc_map, ENC_PICC_LEN));
-    CBOR_ERRCHECK(enc_picc(&picc_map, picc));
-    CBOR_ERRCHECK(cbor_encoder_close_container(&message_map, &picc_map));
-    CBOR_ERRCHECK(cbor_encoder_close_container(root, &message_map));
+    enc_picc_t enc_picc = { 0 };
+    enc_picc_from(picc, &enc_picc);
 
-    return CborNoError;
+    return msg_enc_picc_state_changed(frame, old_state, &enc_picc);
 }
 
-#define ENC_PICC_BLOCK_LEN 2
-static CborError enc_picc_block(CborEncoder *encoder, uint8_t address, uint8_t *data)
+CborError enc_picc_sector_message(web_msg_t *ctx,
+    enc_frame_t *frame,
+    rc522_mifare_sector_desc_t *sector_desc,
+    uint8_t *sector_data,
+    uint16_t gaps,
+    const reply_timing_t *timing)
 {
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "address"));
-    CBOR_ERRCHECK(cbor_encode_uint(encoder, address));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(encoder, "data"));
-    CBOR_ERRCHECK(cbor_encode_byte_string(encoder, data, RC522_MIFARE_BLOCK_SIZE));
+    enc_picc_block_t blocks[ENC_PICC_SECTOR_BLOCKS_COUNT_MAX];
+    CBOR_RETCHECK(sector_desc->number_of_blocks <= ENC_PICC_SECTOR_BLOCKS_COUNT_MAX, CborErrorDataTooLarge);
+    enc_picc_blocks_from(sector_desc->block_0_address, sector_desc->number_of_blocks, sector_data, gaps, blocks);
+
+    enc_timing_t enc_timing = { 0 };
+    enc_timing_span_t enc_rf = { 0 };
+
+    return msg_enc_picc_sector(frame,
+        ctx,
+        sector_desc->index,
+        blocks,
+        sector_desc->number_of_blocks,
+        enc_timing_from(timing, esp_timer_get_time(), &enc_timing, &enc_rf));
+}
 
-    return CborNoError;
+CborError enc_picc_block_message(
+    web_msg_t *ctx, enc_frame_t *frame, uint8_t address, uint8_t *data, const reply_timing_t *timing)
+{
+    enc_timing_t enc_timing = { 0 };
+    enc_timing_span_t enc_rf = { 0 };
+
+    return msg_enc_picc_block(
+        frame, ctx, address, data, enc_timing_from(timing, esp_timer_get_time(), &enc_timing, &enc_rf));
 }
 
-CborError enc_picc_sector_message(
-    web_msg_t *ctx, CborEncoder *root, rc522_mifare_sector_desc_t *sector_desc, uint8_t *sector_data)
+CborError enc_picc_block_changed_message(enc_frame_t *frame, rc522_picc_t *picc, uint8_t address, uint8_t *data)
 {
-    CborEncoder message_map;
-
-    CBOR_ERRCHECK(cbor_encoder_create_map(root, &message_map, ENC_KIND_LEN + ENC_CTX_LEN + 2));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_PICC_SECTOR_MSG_KIND));
-    CBOR_ERRCHECK(enc_ctx(&message_map, ctx));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&message_map, "offset"));
-    CBOR_ERRCHECK(cbor_encode_uint(&message_map, sector_desc->index));
-    CBOR_ERRCHECK(cbor_encode_text_stringz(&message_map, "blocks"));
-    CborEncoder blocks_array;
-    CBOR_ERRCHECK(cbor_encoder_create_array(&message_map, &blocks_array, sector_desc->number_of_blocks));
-    for (uint8_t i = 0; i < sector_desc->number_of_blocks; i++) {
-        CborEncoder block_map;
-        CBOR_ERRCHECK(cbor_encoder_create_map(&blocks_array, &block_map, ENC_PICC_BLOCK_LEN));
-        CBOR_ERRCHECK(
-            enc_picc_block(&block_map, sector_desc->block_0_address + i, sector_data + (i * RC522_MIFARE_BLOCK_SIZE)));
-        CBOR_ERRCHECK(cbor_encoder_close_container(&blocks_array, &block_map));
-    }
-    CBOR_ERRCHECK(cbor_encoder_close_container(&message_map, &blocks_array));
-    CBOR_ERRCHECK(cbor_encoder_close_container(root, &message_map));
+    return msg_enc_picc_block_changed(frame, picc->uid.value, picc->uid.length, address, data);
+}
 
-    return CborNoError;
+CborError enc_snapshot_message(web_msg_t *ctx, enc_frame_t *frame, const snap_sector_t *sector)
+{
+    rc522_mifare_sector_desc_t sector_desc = { 0 };
+    rc522_mifare_get_sector_desc(sector->offset, &sector_desc);
+
+    enc_picc_key_t key = {
+        .type = sector->key.type,
+        .value = sector->key.value,
+    };
+
+    enc_picc_block_t blocks[ENC_SNAPSHOT_BLOCKS_COUNT_MAX];
+    CBOR_RETCHECK(sector->number_of_blocks <= ENC_SNAPSHOT_BLOCKS_COUNT_MAX, CborErrorDataTooLarge);
+    enc_picc_blocks_from(sector_desc.block_0_address, sector->number_of_blocks, sector->data, sector->gaps, blocks);
+
+    return msg_enc_snapshot(frame,
+        ctx,
+        sector->uid,
+        sector->uid_length,
+        sector->offset,
+        &key,
+        sector->timestamp,
+        blocks,
+        sector->number_of_blocks);
 }
 
-CborError enc_picc_block_message(web_msg_t *ctx, CborEncoder *encoder, uint8_t address, uint8_t *data)
+CborError enc_snapshots_message(web_msg_t *ctx, enc_frame_t *frame, uint32_t count)
 {
-    CborEncoder message_map;
+    return msg_enc_snapshots(frame, ctx, count);
+}
 
-    CBOR_ERRCHECK(cbor_encoder_create_map(encoder, &message_map, ENC_KIND_LEN + ENC_CTX_LEN + ENC_PICC_BLOCK_LEN));
-    CBOR_ERRCHECK(enc_kind(&message_map, ENC_PICC_BLOCK_MSG_KIND));
-    CBOR_ERRCHECK(enc_ctx(&message_map, ctx));
-    CBOR_ERRCHECK(enc_picc_block(&message_map, address, data));
-    CBOR_ERRCHECK(cbor_encoder_close_container(encoder, &message_map));
+CborError enc_trace_chunk_message(
+    web_msg_t *ctx, enc_frame_t *frame, uint32_t offset, const uint8_t *chunk, size_t length)
+{
+    return msg_enc_trace_chunk(frame, ctx, offset, chunk, length);
+}
 
-    return CborNoError;
+CborError enc_trace_message(web_msg_t *ctx, enc_frame_t *frame, uint32_t size)
+{
+    return msg_enc_trace(frame, ctx, size);
+}
+
+CborError enc_rf_stats_message(web_msg_t *ctx, enc_frame_t *frame, const rf_sched_stats_t *stats)
+{
+    enc_rf_stats_t enc_stats = {
+        .mode = rf_sched_mode_name(stats->mode),
+        .interval_ms = stats->interval_ms,
+        .scan_windows = stats->scan_windows,
+        .batches = stats->batches,
+        .batch_us = stats->batch_us,
+        .idle_us = stats->mode_us[RF_SCHED_MODE_IDLE],
+        .aggressive_us = stats->mode_us[RF_SCHED_MODE_AGGRESSIVE],
+        .paused_us = stats->mode_us[RF_SCHED_MODE_PAUSED],
+        .detections = stats->detections,
+        .detection_last_us = stats->detection_last_us,
+        .detection_max_us = stats->detection_max_us,
+        .detection_avg_us = stats->detections > 0 ? stats->detection_total_us / stats->detections : 0,
+    };
+
+    return msg_enc_rf_stats(frame, ctx, &enc_stats);
+}
+
+CborError enc_log_message(enc_frame_t *frame, const uint8_t *records, size_t size, uint32_t dropped)
+{
+    return msg_enc_log(frame, records, size, dropped);
 }
 
 // }} encoding
@@ -0,0 +1,110 @@
+#include <string.h>
+#include "picc_access.h"
+
+// {{ access bits
+
+// bit n is set if access bits combo n grants reading of data block
+#define DATA_READ_KEY_A_COMBOS        ((1 << 0b000) | (1 << 0b010) | (1 << 0b100) | (1 << 0b110) | (1 << 0b001))
+#define DATA_READ_KEY_B_COMBOS        (DATA_READ_KEY_A_COMBOS | (1 << 0b011) | (1 << 0b101))
+
+// bit n is set if sector trailer access bits combo n makes key B readable
+#define TRAILER_KEY_B_READABLE_COMBOS ((1 << 0b000) | (1 << 0b010) | (1 << 0b001))
+
+/*
+ * +-----+------+------+------+------+------+------+------+------+
+ * |     |   7  |   6  |   5  |   4  |   3  |   2  |   1  |   0  |
+ * +-----+------+------+------+------+------+------+------+------+
+ * | [6] | ~C23 | ~C22 | ~C21 | ~C20 | ~C13 | ~C12 | ~C11 | ~C10 |
+ * +-----+------+------+------+------+------+------+------+------+
+ * | [7] |  C13 |  C12 |  C11 |  C10 | ~C33 | ~C32 | ~C31 | ~C30 |
+ * +-----+------+------+------+------+------+------+------+------+
+ * | [8] |  C33 |  C32 |  C31 |  C30 |  C23 |  C22 |  C21 |  C20 |
+ * +-----+------+------+------+------+------+------+------+------+
+ */
+
+esp_err_t picc_access_bits_decode(const uint8_t *trailer_data, picc_access_bits_t *out_access_bits)
+{
+    uint8_t c1 = trailer_data[7] >> 4;
+    uint8_t c2 = trailer_data[8] & 0x0F;
+    uint8_t c3 = trailer_data[8] >> 4;
+
+    if ((trailer_data[6] & 0x0F) != (~c1 & 0x0F) || (trailer_data[6] >> 4) != (~c2 & 0x0F)
+        || (trailer_data[7] & 0x0F) != (~c3 & 0x0F)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    picc_access_bits_t access_bits = { 0 };
+
+    for (uint8_t i = 0; i < PICC_ACCESS_POOL_SIZE; i++) {
+        access_bits.combos[i] = (((c1 >> i) & 1) << 2) | (((c2 >> i) & 1) << 1) | ((c3 >> i) & 1);
+    }
+
+    memcpy(out_access_bits, &access_bits, sizeof(access_bits));
+    return ESP_OK;
+}
+
+uint8_t picc_access_pool_index(uint8_t block_offset, uint8_t number_of_blocks)
+{
+    if (block_offset == number_of_blocks - 1) {
+        return PICC_ACCESS_TRAILER_POOL_INDEX;
+    }
+
+    if (number_of_blocks > 4) {
+        return block_offset / 5;
+    }
+
+    return block_offset;
+}
+
+bool picc_access_key_b_usable(const picc_access_bits_t *access_bits)
+{
+    uint8_t trailer_combo = access_bits->combos[PICC_ACCESS_TRAILER_POOL_INDEX];
+
+    return (TRAILER_KEY_B_READABLE_COMBOS & (1 << trailer_combo)) == 0;
+}
+
+bool picc_access_key_can_read(const picc_access_bits_t *access_bits,
+    uint8_t block_offset,
+    uint8_t number_of_blocks,
+    rc522_mifare_key_type_t key_type)
+{
+    uint8_t combo = access_bits->combos[picc_access_pool_index(block_offset, number_of_blocks)];
+
+    if (key_type == RC522_MIFARE_KEY_A) {
+        return (DATA_READ_KEY_A_COMBOS & (1 << combo)) != 0;
+    }
+
+    return picc_access_key_b_usable(access_bits) && (DATA_READ_KEY_B_COMBOS & (1 << combo)) != 0;
+}
+
+// }} access bits
+
+// {{ read planning
+
+void picc_access_plan_read(const picc_access_bits_t *access_bits,
+    uint8_t number_of_blocks,
+    rc522_mifare_key_type_t key_type,
+    bool has_alt_key,
+    picc_read_plan_t *out_plan)
+{
+    rc522_mifare_key_type_t alt_key_type = key_type == RC522_MIFARE_KEY_A ? RC522_MIFARE_KEY_B : RC522_MIFARE_KEY_A;
+    picc_read_plan_t plan = { 0 };
+
+    for (uint8_t i = 0; i < number_of_blocks - 1; i++) {
+        uint16_t block_bit = 1 << i;
+
+        if (picc_access_key_can_read(access_bits, i, number_of_blocks, key_type)) {
+            plan.key_blocks |= block_bit;
+        }
+        else if (has_alt_key && picc_access_key_can_read(access_bits, i, number_of_blocks, alt_key_type)) {
+            plan.alt_key_blocks |= block_bit;
+        }
+        else {
+            plan.gaps |= block_bit;
+        }
+    }
+
+    memcpy(out_plan, &plan, sizeof(plan));
+}
+
+// }} read planning
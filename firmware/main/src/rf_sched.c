@@ -0,0 +1,322 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "rf_sched.h"
+
+#define RF_SCHED_TASK_STACK_SIZE 3072
+#define RF_SCHED_TASK_PRIORITY   3
+
+static const char *TAG = "rf_sched";
+
+static rc522_handle_t scanner;
+static TaskHandle_t task;
+static SemaphoreHandle_t lock;
+static bool scanning = true; // scanner is expected to be started before scheduler
+static int64_t scanning_since_us;
+static uint8_t batch_depth;
+static int64_t batch_start_us;
+static int64_t aggressive_until_us;
+static int64_t web_active_until_us;
+static rf_sched_mode_t mode = RF_SCHED_MODE_AGGRESSIVE;
+static int64_t mode_since_us;
+static rf_sched_stats_t stats = { 0 };
+
+static const char *mode_names[RF_SCHED_MODE_MAX] = {
+    [RF_SCHED_MODE_IDLE] = "idle",
+    [RF_SCHED_MODE_AGGRESSIVE] = "aggressive",
+    [RF_SCHED_MODE_PAUSED] = "paused",
+};
+
+static inline void lock_take()
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+}
+
+static inline void lock_give()
+{
+    xSemaphoreGive(lock);
+}
+
+static inline int64_t ms_to_us(uint32_t ms)
+{
+    return (int64_t)ms * 1000;
+}
+
+static inline int64_t max_i64(int64_t a, int64_t b)
+{
+    return a > b ? a : b;
+}
+
+// lock needs to be held
+static void set_scanning(bool enable)
+{
+    if (scanning == enable) {
+        return;
+    }
+
+    esp_err_t err = enable ? rc522_start(scanner) : rc522_pause(scanner);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to %s scanner (err=%d)", enable ? "resume" : "pause", err);
+        return;
+    }
+
+    scanning = enable;
+
+    if (enable) {
+        scanning_since_us = esp_timer_get_time();
+    }
+}
+
+// lock needs to be held
+static void switch_mode(rf_sched_mode_t new_mode, int64_t now_us)
+{
+    stats.mode_us[mode] += now_us - mode_since_us;
+    mode_since_us = now_us;
+
+    if (new_mode != mode) {
+        ESP_LOGD(TAG, "mode changed from %s to %s", mode_names[mode], mode_names[new_mode]);
+        mode = new_mode;
+    }
+}
+
+// lock needs to be held
+static rf_sched_mode_t eval_mode(int64_t now_us)
+{
+    if (batch_depth > 0) {
+        return RF_SCHED_MODE_PAUSED;
+    }
+
+    if (now_us < aggressive_until_us || now_us < web_active_until_us) {
+        return RF_SCHED_MODE_AGGRESSIVE;
+    }
+
+    return RF_SCHED_MODE_IDLE;
+}
+
+static inline void notify_task()
+{
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void log_stats()
+{
+    rf_sched_stats_t s;
+    rf_sched_get_stats(&s);
+
+    ESP_LOGI(TAG,
+        "stats (mode=%s, interval=%" PRIu32 "ms, windows=%" PRIu32 ", batches=%" PRIu32 ", batch=%" PRIu64
+        "ms, idle=%" PRIu64 "ms, aggressive=%" PRIu64 "ms, paused=%" PRIu64 "ms, detections=%" PRIu32
+        ", detection=%" PRIu32 "us)",
+        mode_names[s.mode],
+        s.interval_ms,
+        s.scan_windows,
+        s.batches,
+        s.batch_us / 1000,
+        s.mode_us[RF_SCHED_MODE_IDLE] / 1000,
+        s.mode_us[RF_SCHED_MODE_AGGRESSIVE] / 1000,
+        s.mode_us[RF_SCHED_MODE_PAUSED] / 1000,
+        s.detections,
+        s.detection_last_us);
+}
+
+static void rf_sched_task(void *arg)
+{
+    int64_t stats_logged_us = esp_timer_get_time();
+
+    for (;;) {
+        TickType_t wait_ticks = portMAX_DELAY;
+
+        lock_take();
+        int64_t now_us = esp_timer_get_time();
+        rf_sched_mode_t next_mode = eval_mode(now_us);
+        switch_mode(next_mode, now_us);
+
+        switch (next_mode) {
+            case RF_SCHED_MODE_PAUSED: {
+                // scanner is already paused by batch, batch end will wake up the task
+            } break;
+            case RF_SCHED_MODE_AGGRESSIVE: {
+                set_scanning(true);
+                int64_t until_us = max_i64(aggressive_until_us, web_active_until_us);
+                wait_ticks = pdMS_TO_TICKS((until_us - now_us) / 1000) + 1;
+            } break;
+            case RF_SCHED_MODE_IDLE:
+            default: {
+                if (scanning) { // close scan window
+                    set_scanning(false);
+                    wait_ticks = pdMS_TO_TICKS(CONFIG_NFCITY_RF_POLL_IDLE_INTERVAL_MS);
+                }
+                else { // open scan window
+                    set_scanning(true);
+                    stats.scan_windows++;
+                    wait_ticks = pdMS_TO_TICKS(CONFIG_NFCITY_RF_SCHED_SCAN_WINDOW_MS);
+                }
+            } break;
+        }
+        lock_give();
+
+#if CONFIG_NFCITY_RF_SCHED_STATS_LOG_INTERVAL_MS > 0
+        if (now_us - stats_logged_us >= ms_to_us(CONFIG_NFCITY_RF_SCHED_STATS_LOG_INTERVAL_MS)) {
+            stats_logged_us = now_us;
+            log_stats();
+        }
+#else
+        (void)stats_logged_us;
+        (void)log_stats;
+#endif
+
+        ulTaskNotifyTake(pdTRUE, wait_ticks);
+    }
+}
+
+esp_err_t rf_sched_start(rc522_handle_t rc522_scanner)
+{
+    ESP_RETURN_ON_FALSE(rc522_scanner != NULL, ESP_ERR_INVALID_ARG, TAG, "scanner is null");
+    ESP_RETURN_ON_FALSE(lock == NULL, ESP_ERR_INVALID_STATE, TAG, "already started");
+
+    lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(lock != NULL, ESP_ERR_NO_MEM, TAG, "no mem for lock");
+
+    scanner = rc522_scanner;
+    mode_since_us = esp_timer_get_time();
+    scanning_since_us = mode_since_us;
+    aggressive_until_us = mode_since_us + ms_to_us(CONFIG_NFCITY_RF_POLL_AGGRESSIVE_HOLD_MS);
+
+#ifdef CONFIG_NFCITY_RF_SCHED_ENABLE
+    if (xTaskCreate(rf_sched_task, "rf_sched", RF_SCHED_TASK_STACK_SIZE, NULL, RF_SCHED_TASK_PRIORITY, &task)
+        != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task");
+        return ESP_FAIL;
+    }
+#else
+    (void)rf_sched_task;
+    ESP_LOGI(TAG, "adaptive polling disabled, scanner polls every %dms", CONFIG_NFCITY_RF_POLL_AGGRESSIVE_INTERVAL_MS);
+#endif
+
+    return ESP_OK;
+}
+
+void rf_sched_notify_picc_removed()
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    lock_take();
+    aggressive_until_us = esp_timer_get_time() + ms_to_us(CONFIG_NFCITY_RF_POLL_AGGRESSIVE_HOLD_MS);
+    lock_give();
+    notify_task();
+}
+
+void rf_sched_notify_picc_detected()
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    lock_take();
+    int64_t latency_us = esp_timer_get_time() - scanning_since_us;
+    // first poll starts within an interval after the resume, activation of the card takes the rest. Later
+    // detections are of cards which arrived while polling, their arrival is not known
+    if (scanning && latency_us <= ms_to_us(2 * CONFIG_NFCITY_RF_POLL_AGGRESSIVE_INTERVAL_MS)) {
+        stats.detections++;
+        stats.detection_last_us = (uint32_t)latency_us;
+        stats.detection_max_us = (uint32_t)max_i64(stats.detection_max_us, latency_us);
+        stats.detection_total_us += latency_us;
+    }
+    lock_give();
+}
+
+void rf_sched_notify_web_activity()
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    lock_take();
+    int64_t now_us = esp_timer_get_time();
+    bool was_idle = now_us >= web_active_until_us;
+    web_active_until_us = now_us + ms_to_us(CONFIG_NFCITY_RF_POLL_WEB_ACTIVITY_TIMEOUT_MS);
+    lock_give();
+
+    if (was_idle) {
+        notify_task();
+    }
+}
+
+void rf_sched_batch_begin()
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    lock_take();
+    if (batch_depth++ == 0) {
+        int64_t now_us = esp_timer_get_time();
+        batch_start_us = now_us;
+        stats.batches++;
+        if (task != NULL) {
+            switch_mode(RF_SCHED_MODE_PAUSED, now_us);
+            set_scanning(false);
+        }
+    }
+    lock_give();
+}
+
+void rf_sched_batch_end()
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    lock_take();
+    assert(batch_depth > 0);
+    bool batch_done = --batch_depth == 0;
+    if (batch_done) {
+        stats.batch_us += esp_timer_get_time() - batch_start_us;
+    }
+    lock_give();
+
+    if (batch_done) {
+        notify_task();
+    }
+}
+
+void rf_sched_get_stats(rf_sched_stats_t *out_stats)
+{
+    if (lock == NULL) {
+        memset(out_stats, 0, sizeof(rf_sched_stats_t));
+        return;
+    }
+
+    lock_take();
+    int64_t now_us = esp_timer_get_time();
+    memcpy(out_stats, &stats, sizeof(rf_sched_stats_t));
+    out_stats->mode = task != NULL ? mode : RF_SCHED_MODE_AGGRESSIVE;
+    out_stats->mode_us[out_stats->mode] += now_us - mode_since_us;
+    lock_give();
+
+    switch (out_stats->mode) {
+        case RF_SCHED_MODE_AGGRESSIVE: {
+            out_stats->interval_ms = CONFIG_NFCITY_RF_POLL_AGGRESSIVE_INTERVAL_MS;
+        } break;
+        case RF_SCHED_MODE_IDLE: {
+            out_stats->interval_ms = CONFIG_NFCITY_RF_POLL_IDLE_INTERVAL_MS + CONFIG_NFCITY_RF_SCHED_SCAN_WINDOW_MS;
+        } break;
+        default: {
+            out_stats->interval_ms = 0; // not polling
+        } break;
+    }
+}
+
+const char *rf_sched_mode_name(rf_sched_mode_t sched_mode)
+{
+    return sched_mode < RF_SCHED_MODE_MAX ? mode_names[sched_mode] : "unknown";
+}
@@ -0,0 +1,749 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "snap_store.h"
+
+/*
+ * Snapshots are kept in a circular log of records on a dedicated partition.
+ * Records never span across flash sectors. Flash sector after the head is always
+ * kept erased, and when head moves into it, live records of the next (oldest)
+ * sector are relocated to the head and that sector is erased. That way every
+ * flash sector is erased once per cycle through the log.
+ */
+
+#define FLASH_SECTOR_SIZE    4096
+#define RECORD_MAGIC         0x534F // changes with the layout of the header, records of other layouts are dropped
+#define RECORD_SECTOR        0x01 // snapshot of the sector
+#define RECORD_DROP          0x02 // drops snapshot of the sector
+#define RECORD_EVICT         0x03 // drops all snapshots of the card
+#define RECORD_NONE          UINT32_MAX
+#define RECORD_DATA_SIZE     (SNAP_STORE_BLOCKS_MAX * RC522_MIFARE_BLOCK_SIZE)
+#define INDEX_SIZE           (CONFIG_NFCITY_SNAPSHOT_CAPACITY * 2)
+#define LOCK_TAKE_TIMEOUT_MS 1000
+
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t type;
+    uint8_t uid_length;
+    uint8_t uid[SNAP_STORE_UID_SIZE_MAX];
+    uint8_t offset;
+    uint8_t number_of_blocks;
+    uint16_t gaps;
+    uint8_t key_type;
+    uint8_t key[RC522_MIFARE_KEY_SIZE];
+    uint8_t alt_key_type;
+    uint8_t alt_key[RC522_MIFARE_KEY_SIZE];
+    uint16_t alt_key_blocks;
+    uint8_t has_alt_key;
+    uint8_t reserved;
+    uint32_t timestamp;
+    uint32_t seq;
+    uint32_t crc;
+} record_header_t;
+
+_Static_assert(sizeof(record_header_t) % 4 == 0, "record header needs to be word aligned");
+
+typedef struct
+{
+    bool used;
+    uint8_t uid[SNAP_STORE_UID_SIZE_MAX];
+    uint8_t uid_length;
+    uint32_t last_used; // seq of the last access, for eviction
+    uint32_t live_bytes;
+    uint32_t records[SNAP_STORE_SECTORS_MAX]; // partition offset of the latest record of each sector
+} card_t;
+
+static const char *TAG = "snap_store";
+
+static const esp_partition_t *partition;
+static SemaphoreHandle_t lock;
+static card_t cards[CONFIG_NFCITY_SNAPSHOT_CAPACITY];
+static int16_t index_table[INDEX_SIZE]; // uid hash -> index of the card, -1 if empty
+static uint32_t flash_sectors;
+static uint32_t head_sector;
+static uint32_t head_used;
+static uint32_t seq;
+static uint32_t live_bytes;
+static uint32_t live_bytes_max;
+static bool relocating;
+static uint8_t record_buffer[sizeof(record_header_t) + RECORD_DATA_SIZE];
+
+// {{ index
+
+static uint32_t uid_hash(const uint8_t *uid, uint8_t uid_length)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+
+    for (uint8_t i = 0; i < uid_length; i++) {
+        hash = (hash ^ uid[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static int16_t find_card(const uint8_t *uid, uint8_t uid_length)
+{
+    for (uint32_t i = uid_hash(uid, uid_length) % INDEX_SIZE;; i = (i + 1) % INDEX_SIZE) {
+        int16_t card_index = index_table[i];
+
+        if (card_index < 0) {
+            return -1;
+        }
+
+        card_t *card = &cards[card_index];
+
+        if (card->uid_length == uid_length && memcmp(card->uid, uid, uid_length) == 0) {
+            return card_index;
+        }
+    }
+}
+
+static void index_insert(int16_t card_index)
+{
+    card_t *card = &cards[card_index];
+    uint32_t i = uid_hash(card->uid, card->uid_length) % INDEX_SIZE;
+
+    while (index_table[i] >= 0) {
+        i = (i + 1) % INDEX_SIZE;
+    }
+
+    index_table[i] = card_index;
+}
+
+static void index_rebuild()
+{
+    memset(index_table, 0xFF, sizeof(index_table));
+
+    for (int16_t i = 0; i < CONFIG_NFCITY_SNAPSHOT_CAPACITY; i++) {
+        if (cards[i].used) {
+            index_insert(i);
+        }
+    }
+}
+
+static int16_t alloc_card(const uint8_t *uid, uint8_t uid_length)
+{
+    for (int16_t i = 0; i < CONFIG_NFCITY_SNAPSHOT_CAPACITY; i++) {
+        card_t *card = &cards[i];
+
+        if (card->used) {
+            continue;
+        }
+
+        memset(card, 0, sizeof(card_t));
+        card->used = true;
+        memcpy(card->uid, uid, uid_length);
+        card->uid_length = uid_length;
+        card->last_used = seq;
+        memset(card->records, 0xFF, sizeof(card->records));
+        index_insert(i);
+
+        return i;
+    }
+
+    return -1;
+}
+
+static void free_card(int16_t card_index)
+{
+    live_bytes -= cards[card_index].live_bytes;
+    cards[card_index].used = false;
+    index_rebuild();
+}
+
+static int16_t lru_card(int16_t except_card_index)
+{
+    int16_t lru_index = -1;
+
+    for (int16_t i = 0; i < CONFIG_NFCITY_SNAPSHOT_CAPACITY; i++) {
+        if (!cards[i].used || i == except_card_index) {
+            continue;
+        }
+
+        if (lru_index < 0 || cards[i].last_used < cards[lru_index].last_used) {
+            lru_index = i;
+        }
+    }
+
+    return lru_index;
+}
+
+// }} index
+
+// {{ log
+
+static inline uint8_t sector_number_of_blocks(uint8_t offset)
+{
+    return offset < 32 ? 4 : 16;
+}
+
+static inline uint32_t record_length(const record_header_t *header)
+{
+    return sizeof(record_header_t) + (header->number_of_blocks * RC522_MIFARE_BLOCK_SIZE);
+}
+
+static uint32_t record_crc(const record_header_t *header, const uint8_t *data)
+{
+    record_header_t h = *header;
+    h.crc = 0;
+
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&h, sizeof(h));
+    return esp_rom_crc32_le(crc, data, header->number_of_blocks * RC522_MIFARE_BLOCK_SIZE);
+}
+
+/**
+ * Reads and validates the record at @p offset, data is read to @p out_data if not null
+ */
+static esp_err_t read_record(uint32_t offset, record_header_t *out_header, uint8_t *out_data)
+{
+    record_header_t header;
+    ESP_RETURN_ON_ERROR(esp_partition_read(partition, offset, &header, sizeof(header)), TAG, "header read failed");
+
+    if (header.magic != RECORD_MAGIC || header.uid_length > SNAP_STORE_UID_SIZE_MAX
+        || header.number_of_blocks > SNAP_STORE_BLOCKS_MAX || header.offset >= SNAP_STORE_SECTORS_MAX
+        || (offset % FLASH_SECTOR_SIZE) + record_length(&header) > FLASH_SECTOR_SIZE) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t *data = out_data != NULL ? out_data : record_buffer;
+    uint32_t data_length = header.number_of_blocks * RC522_MIFARE_BLOCK_SIZE;
+
+    if (data_length > 0) {
+        ESP_RETURN_ON_ERROR(esp_partition_read(partition, offset + sizeof(header), data, data_length),
+            TAG,
+            "data read failed");
+    }
+
+    if (record_crc(&header, data) != header.crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    memcpy(out_header, &header, sizeof(header));
+    return ESP_OK;
+}
+
+static esp_err_t erase_sector(uint32_t sector)
+{
+    return esp_partition_erase_range(partition, sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+}
+
+static esp_err_t gc_sector(uint32_t sector);
+
+static esp_err_t advance_head()
+{
+    head_sector = (head_sector + 1) % flash_sectors;
+    head_used = 0;
+
+    return gc_sector((head_sector + 1) % flash_sectors);
+}
+
+/**
+ * Appends the record to the head of the log
+ */
+static esp_err_t append_record(record_header_t *header, const uint8_t *data, uint32_t *out_offset)
+{
+    uint32_t length = record_length(header);
+
+    // relocation fills the new head with live records of the collected sector, so the fit is checked again
+    for (uint32_t advances = 0; head_used + length > FLASH_SECTOR_SIZE; advances++) {
+        ESP_RETURN_ON_FALSE(!relocating, ESP_ERR_NO_MEM, TAG, "no space for relocation");
+        ESP_RETURN_ON_FALSE(advances < flash_sectors - 1, ESP_ERR_NO_MEM, TAG, "no space for record");
+        ESP_RETURN_ON_ERROR(advance_head(), TAG, "failed to advance head");
+    }
+
+    header->magic = RECORD_MAGIC;
+    header->seq = seq++;
+    header->crc = record_crc(header, data);
+
+    memcpy(record_buffer, header, sizeof(record_header_t));
+    if (length > sizeof(record_header_t)) {
+        memcpy(record_buffer + sizeof(record_header_t), data, length - sizeof(record_header_t));
+    }
+
+    uint32_t offset = head_sector * FLASH_SECTOR_SIZE + head_used;
+    ESP_RETURN_ON_ERROR(esp_partition_write(partition, offset, record_buffer, length), TAG, "write failed");
+    head_used += length;
+
+    if (out_offset != NULL) {
+        *out_offset = offset;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * Relocates live records of the @p sector to the head and erases the sector
+ */
+static esp_err_t gc_sector(uint32_t sector)
+{
+    static uint8_t data[RECORD_DATA_SIZE];
+    esp_err_t ret = ESP_OK;
+    uint32_t relocated = 0;
+
+    relocating = true;
+
+    for (uint32_t used = 0; used + sizeof(record_header_t) <= FLASH_SECTOR_SIZE;) {
+        uint32_t offset = sector * FLASH_SECTOR_SIZE + used;
+        record_header_t header;
+
+        if (read_record(offset, &header, data) != ESP_OK) {
+            break;
+        }
+
+        used += record_length(&header);
+
+        if (header.type != RECORD_SECTOR) {
+            continue; // everything older than tombstone is already gone
+        }
+
+        int16_t card_index = find_card(header.uid, header.uid_length);
+
+        if (card_index < 0 || cards[card_index].records[header.offset] != offset) {
+            continue; // dead record
+        }
+
+        ESP_GOTO_ON_ERROR(append_record(&header, data, &cards[card_index].records[header.offset]),
+            _exit,
+            TAG,
+            "relocation failed");
+        relocated++;
+    }
+
+    ESP_GOTO_ON_ERROR(erase_sector(sector), _exit, TAG, "erase failed");
+    ESP_LOGD(TAG, "sector %" PRIu32 " collected (relocated=%" PRIu32 ")", sector, relocated);
+_exit:
+    relocating = false;
+    return ret;
+}
+
+static esp_err_t append_tombstone(uint8_t type, const uint8_t *uid, uint8_t uid_length, uint8_t offset)
+{
+    record_header_t header = {
+        .type = type,
+        .uid_length = uid_length,
+        .offset = offset,
+    };
+
+    memcpy(header.uid, uid, uid_length);
+
+    return append_record(&header, NULL, NULL);
+}
+
+static esp_err_t evict_card(int16_t card_index)
+{
+    card_t *card = &cards[card_index];
+
+    ESP_LOGI(TAG, "evicting card (uid_length=%d, live_bytes=%" PRIu32 ")", card->uid_length, card->live_bytes);
+    ESP_RETURN_ON_ERROR(append_tombstone(RECORD_EVICT, card->uid, card->uid_length, 0), TAG, "evict failed");
+    free_card(card_index);
+
+    return ESP_OK;
+}
+
+// }} log
+
+// {{ mount
+
+static void apply_record(const record_header_t *header, uint32_t offset)
+{
+    int16_t card_index = find_card(header->uid, header->uid_length);
+    card_t *card = card_index >= 0 ? &cards[card_index] : NULL;
+
+    switch (header->type) {
+        case RECORD_SECTOR: {
+            if (card == NULL && (card_index = alloc_card(header->uid, header->uid_length)) < 0) {
+                ESP_LOGW(TAG, "capacity exceeded while mounting, record skipped");
+                return;
+            }
+            card = &cards[card_index];
+            uint32_t length = record_length(header);
+            if (card->records[header->offset] == RECORD_NONE) {
+                card->live_bytes += length;
+                live_bytes += length;
+            }
+            card->records[header->offset] = offset;
+            card->last_used = header->seq;
+        } break;
+        case RECORD_DROP: {
+            if (card != NULL && card->records[header->offset] != RECORD_NONE) {
+                uint32_t length = sizeof(record_header_t)
+                    + sector_number_of_blocks(header->offset) * RC522_MIFARE_BLOCK_SIZE;
+                card->live_bytes -= length;
+                live_bytes -= length;
+                card->records[header->offset] = RECORD_NONE;
+            }
+        } break;
+        case RECORD_EVICT: {
+            if (card != NULL) {
+                free_card(card_index);
+            }
+        } break;
+    }
+}
+
+/**
+ * @return number of bytes used by valid records in the @p sector
+ */
+static uint32_t mount_sector(uint32_t sector)
+{
+    uint32_t used = 0;
+
+    while (used + sizeof(record_header_t) <= FLASH_SECTOR_SIZE) {
+        uint32_t offset = sector * FLASH_SECTOR_SIZE + used;
+        record_header_t header;
+
+        if (read_record(offset, &header, NULL) != ESP_OK) {
+            break;
+        }
+
+        apply_record(&header, offset);
+        used += record_length(&header);
+
+        if (header.seq >= seq) {
+            seq = header.seq + 1;
+        }
+    }
+
+    return used;
+}
+
+static bool sector_is_blank(uint32_t sector)
+{
+    uint32_t word = 0;
+
+    for (uint32_t i = 0; i < sizeof(record_header_t); i += sizeof(word)) {
+        if (esp_partition_read(partition, sector * FLASH_SECTOR_SIZE + i, &word, sizeof(word)) != ESP_OK
+            || word != UINT32_MAX) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+esp_err_t snap_store_init()
+{
+    ESP_RETURN_ON_FALSE(partition == NULL, ESP_ERR_INVALID_STATE, TAG, "already initialized");
+
+    const esp_partition_t *part
+        = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SNAP_STORE_PARTITION_LABEL);
+    ESP_RETURN_ON_FALSE(part != NULL, ESP_ERR_NOT_FOUND, TAG, "partition '%s' not found", SNAP_STORE_PARTITION_LABEL);
+    ESP_RETURN_ON_FALSE(part->size / FLASH_SECTOR_SIZE >= 3, ESP_ERR_INVALID_SIZE, TAG, "partition too small");
+
+    lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(lock != NULL, ESP_ERR_NO_MEM, TAG, "no mem for lock");
+
+    partition = part;
+    flash_sectors = partition->size / FLASH_SECTOR_SIZE;
+    live_bytes_max = (flash_sectors - 2) * FLASH_SECTOR_SIZE * 3 / 4;
+    memset(cards, 0, sizeof(cards));
+    index_rebuild();
+
+    // sectors are mounted from the oldest to the newest, so newer records override older ones
+    uint32_t first_seqs[flash_sectors];
+    uint32_t mounted = 0;
+
+    for (uint32_t i = 0; i < flash_sectors; i++) {
+        record_header_t header;
+        first_seqs[i] = read_record(i * FLASH_SECTOR_SIZE, &header, NULL) == ESP_OK ? header.seq : RECORD_NONE;
+    }
+
+    head_sector = 0;
+    head_used = 0;
+
+    for (uint32_t last_seq = 0;; mounted++) {
+        uint32_t next = RECORD_NONE;
+
+        for (uint32_t i = 0; i < flash_sectors; i++) {
+            if (first_seqs[i] != RECORD_NONE && (mounted == 0 || first_seqs[i] > last_seq)
+                && (next == RECORD_NONE || first_seqs[i] < first_seqs[next])) {
+                next = i;
+            }
+        }
+
+        if (next == RECORD_NONE) {
+            break;
+        }
+
+        last_seq = first_seqs[next];
+        head_sector = next;
+        head_used = mount_sector(next);
+    }
+
+    // keep the invariant: sector after the head is erased
+    uint32_t ahead = (head_sector + 1) % flash_sectors;
+
+    if (first_seqs[ahead] != RECORD_NONE) { // crashed during the collection
+        ESP_RETURN_ON_ERROR(gc_sector(ahead), TAG, "failed to collect sector");
+    }
+    else if (!sector_is_blank(ahead)) {
+        ESP_RETURN_ON_ERROR(erase_sector(ahead), TAG, "failed to erase sector");
+    }
+
+    if (mounted == 0 && !sector_is_blank(head_sector)) {
+        ESP_RETURN_ON_ERROR(erase_sector(head_sector), TAG, "failed to erase sector");
+    }
+
+    uint32_t card_count = 0;
+    for (int16_t i = 0; i < CONFIG_NFCITY_SNAPSHOT_CAPACITY; i++) {
+        card_count += cards[i].used ? 1 : 0;
+    }
+
+    ESP_LOGI(TAG,
+        "mounted (cards=%" PRIu32 ", live=%" PRIu32 "/%" PRIu32 " bytes, head=%" PRIu32 ":%" PRIu32 ")",
+        card_count,
+        live_bytes,
+        live_bytes_max,
+        head_sector,
+        head_used);
+
+    return ESP_OK;
+}
+
+// }} mount
+
+// {{ api
+
+static inline esp_err_t lock_take()
+{
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(lock, pdMS_TO_TICKS(LOCK_TAKE_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to take lock");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+static inline void lock_give()
+{
+    xSemaphoreGive(lock);
+}
+
+static esp_err_t put_sector(const snap_sector_t *sector)
+{
+    ESP_RETURN_ON_FALSE(sector->uid_length > 0 && sector->uid_length <= SNAP_STORE_UID_SIZE_MAX,
+        ESP_ERR_INVALID_ARG,
+        TAG,
+        "invalid uid length");
+    ESP_RETURN_ON_FALSE(sector->offset < SNAP_STORE_SECTORS_MAX
+            && sector->number_of_blocks == sector_number_of_blocks(sector->offset),
+        ESP_ERR_INVALID_ARG,
+        TAG,
+        "invalid sector");
+
+    int16_t card_index = find_card(sector->uid, sector->uid_length);
+
+    if (card_index < 0 && (card_index = alloc_card(sector->uid, sector->uid_length)) < 0) {
+        ESP_RETURN_ON_ERROR(evict_card(lru_card(-1)), TAG, "failed to free capacity");
+        card_index = alloc_card(sector->uid, sector->uid_length);
+    }
+
+    card_t *card = &cards[card_index];
+    record_header_t header = {
+        .type = RECORD_SECTOR,
+        .uid_length = sector->uid_length,
+        .offset = sector->offset,
+        .number_of_blocks = sector->number_of_blocks,
+        .gaps = sector->gaps,
+        .key_type = sector->key.type,
+        .alt_key_type = sector->alt_key.type,
+        .alt_key_blocks = sector->has_alt_key ? sector->alt_key_blocks : 0,
+        .has_alt_key = sector->has_alt_key,
+        .timestamp = sector->timestamp,
+    };
+    memcpy(header.uid, sector->uid, sector->uid_length);
+    memcpy(header.key, sector->key.value, RC522_MIFARE_KEY_SIZE);
+    memcpy(header.alt_key, sector->alt_key.value, RC522_MIFARE_KEY_SIZE);
+
+    uint32_t length = record_length(&header);
+    uint32_t replaced_length = card->records[sector->offset] != RECORD_NONE ? length : 0;
+
+    while (live_bytes - replaced_length + length > live_bytes_max) {
+        int16_t lru_index = lru_card(card_index);
+        ESP_RETURN_ON_FALSE(lru_index >= 0, ESP_ERR_NO_MEM, TAG, "card does not fit into partition");
+        ESP_RETURN_ON_ERROR(evict_card(lru_index), TAG, "failed to free space");
+    }
+
+    ESP_RETURN_ON_ERROR(append_record(&header, sector->data, &card->records[sector->offset]), TAG, "append failed");
+    card->live_bytes += length - replaced_length;
+    card->last_used = header.seq;
+    live_bytes += length - replaced_length;
+
+    return ESP_OK;
+}
+
+esp_err_t snap_store_put_sector(const snap_sector_t *sector)
+{
+    esp_err_t err = lock_take();
+    if (err != ESP_OK) { // store is not mounted or lock timed out (logged by lock_take)
+        return err;
+    }
+
+    err = put_sector(sector);
+    lock_give();
+
+    return err;
+}
+
+static esp_err_t get_sector(int16_t card_index, uint8_t offset, snap_sector_t *out_sector)
+{
+    card_t *card = &cards[card_index];
+
+    if (card->records[offset] == RECORD_NONE) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    record_header_t header;
+    snap_sector_t sector = { 0 };
+    ESP_RETURN_ON_ERROR(read_record(card->records[offset], &header, sector.data), TAG, "read failed");
+
+    memcpy(sector.uid, header.uid, header.uid_length);
+    sector.uid_length = header.uid_length;
+    sector.offset = header.offset;
+    sector.number_of_blocks = header.number_of_blocks;
+    sector.gaps = header.gaps;
+    sector.key.type = header.key_type;
+    memcpy(sector.key.value, header.key, RC522_MIFARE_KEY_SIZE);
+    sector.has_alt_key = header.has_alt_key != 0;
+    sector.alt_key.type = header.alt_key_type;
+    memcpy(sector.alt_key.value, header.alt_key, RC522_MIFARE_KEY_SIZE);
+    sector.alt_key_blocks = header.alt_key_blocks;
+    sector.timestamp = header.timestamp;
+
+    memcpy(out_sector, &sector, sizeof(sector));
+    return ESP_OK;
+}
+
+static esp_err_t drop_sector(int16_t card_index, uint8_t offset, uint8_t number_of_blocks)
+{
+    card_t *card = &cards[card_index];
+    uint32_t length = sizeof(record_header_t) + number_of_blocks * RC522_MIFARE_BLOCK_SIZE;
+
+    ESP_RETURN_ON_ERROR(append_tombstone(RECORD_DROP, card->uid, card->uid_length, offset), TAG, "drop failed");
+
+    card->records[offset] = RECORD_NONE;
+    card->live_bytes -= length;
+    live_bytes -= length;
+
+    return ESP_OK;
+}
+
+esp_err_t snap_store_get_sector(const uint8_t *uid, uint8_t uid_length, uint8_t offset, snap_sector_t *out_sector)
+{
+    ESP_RETURN_ON_FALSE(offset < SNAP_STORE_SECTORS_MAX, ESP_ERR_INVALID_ARG, TAG, "invalid offset");
+    esp_err_t err = lock_take();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = ESP_ERR_NOT_FOUND;
+    int16_t card_index = find_card(uid, uid_length);
+
+    if (card_index >= 0 && (err = get_sector(card_index, offset, out_sector)) == ESP_OK) {
+        cards[card_index].last_used = seq;
+    }
+
+    lock_give();
+
+    return err;
+}
+
+esp_err_t snap_store_patch_block(const uint8_t *uid, uint8_t uid_length, uint8_t address, const uint8_t *data)
+{
+    uint8_t offset = address < 128 ? address / 4 : 32 + ((address - 128) / 16);
+    uint8_t block_offset = address < 128 ? address % 4 : (address - 128) % 16;
+
+    ESP_RETURN_ON_FALSE(offset < SNAP_STORE_SECTORS_MAX, ESP_ERR_INVALID_ARG, TAG, "invalid address");
+    esp_err_t err = lock_take();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    static snap_sector_t sector;
+    err = ESP_ERR_NOT_FOUND;
+    int16_t card_index = find_card(uid, uid_length);
+
+    if (card_index < 0 || (err = get_sector(card_index, offset, &sector)) != ESP_OK) {
+        goto _exit;
+    }
+
+    if (block_offset == sector.number_of_blocks - 1) { // trailer, keys might have been changed
+        err = drop_sector(card_index, offset, sector.number_of_blocks);
+        goto _exit;
+    }
+
+    if (sector.gaps & (1 << block_offset)) { // write access does not prove that the block is readable
+        goto _exit;
+    }
+
+    memcpy(sector.data + (block_offset * RC522_MIFARE_BLOCK_SIZE), data, RC522_MIFARE_BLOCK_SIZE);
+    err = put_sector(&sector);
+_exit:
+    lock_give();
+
+    return err;
+}
+
+esp_err_t snap_store_drop_sector(const uint8_t *uid, uint8_t uid_length, uint8_t offset)
+{
+    ESP_RETURN_ON_FALSE(offset < SNAP_STORE_SECTORS_MAX, ESP_ERR_INVALID_ARG, TAG, "invalid offset");
+    esp_err_t err = lock_take();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    static snap_sector_t sector;
+    err = ESP_ERR_NOT_FOUND;
+    int16_t card_index = find_card(uid, uid_length);
+
+    if (card_index >= 0 && (err = get_sector(card_index, offset, &sector)) == ESP_OK) {
+        err = drop_sector(card_index, offset, sector.number_of_blocks);
+    }
+
+    lock_give();
+
+    return err;
+}
+
+uint32_t snap_store_foreach(snap_store_sector_cb_t cb, void *arg)
+{
+    if (lock_take() != ESP_OK) {
+        return 0;
+    }
+
+    static snap_sector_t sector;
+    uint32_t visited = 0;
+
+    for (int16_t i = 0; i < CONFIG_NFCITY_SNAPSHOT_CAPACITY; i++) {
+        if (!cards[i].used) {
+            continue;
+        }
+
+        for (uint8_t offset = 0; offset < SNAP_STORE_SECTORS_MAX; offset++) {
+            if (get_sector(i, offset, &sector) != ESP_OK) {
+                continue;
+            }
+
+            visited++;
+
+            if (!cb(&sector, arg)) {
+                goto _exit;
+            }
+        }
+    }
+_exit:
+    lock_give();
+
+    return visited;
+}
+
+// }} api
@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "cbor.h"
+#include "trace.h"
+
+/*
+ * Records are appended to a byte ring, and may wrap around its end.
+ * When there is no room for a new record, the oldest records are dropped.
+ */
+
+static const char *TAG = "trace";
+
+static SemaphoreHandle_t lock;
+static uint8_t *ring;
+static size_t ring_head; // write position
+static size_t ring_tail; // position of the oldest record
+static size_t ring_used;
+static uint32_t dropped;
+static int64_t last_record_us;
+static bool dumping;
+static uint8_t chunk_buffer[TRACE_CHUNK_SIZE_MAX];
+
+// {{ ring
+
+static void ring_write(const void *src, size_t length)
+{
+    const uint8_t *src_ptr = src;
+
+    while (length > 0) {
+        size_t n = CONFIG_NFCITY_TRACE_BUFFER_SIZE - ring_head;
+        n = n < length ? n : length;
+        memcpy(ring + ring_head, src_ptr, n);
+        ring_head = (ring_head + n) % CONFIG_NFCITY_TRACE_BUFFER_SIZE;
+        ring_used += n;
+        src_ptr += n;
+        length -= n;
+    }
+}
+
+static void ring_peek(size_t position, void *dst, size_t length)
+{
+    uint8_t *dst_ptr = dst;
+
+    while (length > 0) {
+        size_t n = CONFIG_NFCITY_TRACE_BUFFER_SIZE - position;
+        n = n < length ? n : length;
+        memcpy(dst_ptr, ring + position, n);
+        position = (position + n) % CONFIG_NFCITY_TRACE_BUFFER_SIZE;
+        dst_ptr += n;
+        length -= n;
+    }
+}
+
+static void ring_make_room(size_t length)
+{
+    while (CONFIG_NFCITY_TRACE_BUFFER_SIZE - ring_used < length) {
+        trace_record_header_t header;
+        ring_peek(ring_tail, &header, sizeof(header));
+        size_t record_size = sizeof(header) + header.length;
+        ring_tail = (ring_tail + record_size) % CONFIG_NFCITY_TRACE_BUFFER_SIZE;
+        ring_used -= record_size;
+        dropped++;
+    }
+}
+
+static void ring_clear()
+{
+    ring_head = ring_tail = ring_used = 0;
+    dropped = 0;
+}
+
+// }} ring
+
+// {{ recording
+
+static inline bool lock_take()
+{
+    return lock != NULL && xSemaphoreTake(lock, portMAX_DELAY) == pdTRUE;
+}
+
+static inline void lock_give()
+{
+    xSemaphoreGive(lock);
+}
+
+static void append(trace_record_type_t type, const void *payload, size_t length, const void *extra, size_t extra_length)
+{
+    size_t record_size = sizeof(trace_record_header_t) + length + extra_length;
+
+    if (record_size > CONFIG_NFCITY_TRACE_BUFFER_SIZE || length + extra_length > UINT16_MAX) {
+        return;
+    }
+
+    if (!lock_take()) {
+        return;
+    }
+
+    if (dumping) {
+        lock_give();
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t delta_us = now_us - last_record_us;
+    last_record_us = now_us;
+
+    trace_record_header_t header = {
+        .type = type,
+        .length = length + extra_length,
+        .delta_us = delta_us < 0 ? 0 : (delta_us > UINT32_MAX ? UINT32_MAX : delta_us),
+    };
+
+    ring_make_room(record_size);
+    ring_write(&header, sizeof(header));
+    ring_write(payload, length);
+    if (extra_length > 0) {
+        ring_write(extra, extra_length);
+    }
+
+    lock_give();
+}
+
+void trace_mqtt_out_digest(const uint8_t *data, size_t length, trace_mqtt_out_t *out_digest)
+{
+    const uint8_t *end = data + length;
+    const uint8_t *fields = data; // whole message, unless it is a map
+    const uint8_t *timing = end;
+    const uint8_t *timing_end = end;
+
+    CborParser parser;
+    CborValue map;
+    CborValue it;
+
+    if (cbor_parser_init(data, length, 0, &parser, &map) == CborNoError && cbor_value_is_map(&map)
+        && cbor_value_enter_container(&map, &it) == CborNoError) {
+        fields = cbor_value_get_next_byte(&it);
+
+        while (!cbor_value_at_end(&it)) {
+            const uint8_t *field = cbor_value_get_next_byte(&it);
+            bool is_timing = false;
+
+            if (cbor_value_is_text_string(&it)
+                && cbor_value_text_string_equals(&it, "$timing", &is_timing) != CborNoError) {
+                break;
+            }
+
+            if (cbor_value_advance(&it) != CborNoError || cbor_value_advance(&it) != CborNoError) { // key and value
+                break;
+            }
+
+            if (is_timing) {
+                timing = field;
+                timing_end = cbor_value_get_next_byte(&it);
+                break;
+            }
+        }
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, fields, timing - fields);
+    out_digest->crc = esp_rom_crc32_le(crc, timing_end, end - timing_end);
+    out_digest->length = (timing - fields) + (end - timing_end);
+}
+
+esp_err_t trace_init()
+{
+    ESP_RETURN_ON_FALSE(lock == NULL, ESP_ERR_INVALID_STATE, TAG, "already initialized");
+
+    ring = malloc(CONFIG_NFCITY_TRACE_BUFFER_SIZE);
+    ESP_RETURN_ON_FALSE(ring != NULL, ESP_ERR_NO_MEM, TAG, "no mem for ring");
+
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        free(ring);
+        ring = NULL;
+        ESP_LOGE(TAG, "no mem for lock");
+        return ESP_ERR_NO_MEM;
+    }
+
+    last_record_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "recording into %d bytes ring", CONFIG_NFCITY_TRACE_BUFFER_SIZE);
+
+    return ESP_OK;
+}
+
+void trace_mqtt_in(const uint8_t *data, size_t length)
+{
+    append(TRACE_RECORD_MQTT_IN, data, length, NULL, 0);
+}
+
+void trace_mqtt_out(const uint8_t *data, size_t length)
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    trace_mqtt_out_t out = { 0 };
+    trace_mqtt_out_digest(data, length, &out);
+
+    append(TRACE_RECORD_MQTT_OUT, &out, sizeof(out), NULL, 0);
+}
+
+void trace_rf(trace_rf_op_t op, uint8_t address, esp_err_t result, int64_t start_us, const uint8_t *data)
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    trace_rf_t rf = {
+        .op = op,
+        .address = address,
+        .result = result,
+        .duration_us = esp_timer_get_time() - start_us,
+    };
+
+    append(TRACE_RECORD_RF, &rf, sizeof(rf), data, data != NULL ? RC522_MIFARE_BLOCK_SIZE : 0);
+}
+
+void trace_picc(const rc522_picc_t *picc, rc522_picc_state_t old_state)
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    trace_picc_t p = {
+        .old_state = old_state,
+        .state = picc->state,
+        .type = picc->type,
+        .sak = picc->sak,
+        .atqa = picc->atqa.source,
+        .uid_length = picc->uid.length,
+    };
+
+    memcpy(p.uid, picc->uid.value, picc->uid.length);
+
+    append(TRACE_RECORD_PICC, &p, sizeof(p), NULL, 0);
+}
+
+// }} recording
+
+// {{ dumping
+
+esp_err_t trace_dump(trace_chunk_cb_t cb, void *arg, size_t *out_size)
+{
+    ESP_RETURN_ON_FALSE(lock_take(), ESP_ERR_INVALID_STATE, TAG, "not initialized");
+    dumping = true; // ring is not modified until the end of the dump
+    trace_header_t header = {
+        .magic = TRACE_MAGIC,
+        .version = TRACE_VERSION,
+        .header_size = sizeof(trace_header_t),
+        .dropped = dropped,
+        .size = ring_used,
+    };
+    size_t tail = ring_tail;
+    lock_give();
+
+    size_t size = sizeof(header) + header.size;
+    size_t offset = 0;
+    bool completed = true;
+
+    while (offset < size) {
+        size_t length = 0;
+
+        while (length < sizeof(chunk_buffer) && offset + length < size) {
+            size_t position = offset + length;
+            size_t n;
+
+            if (position < sizeof(header)) {
+                n = sizeof(header) - position;
+                n = n < sizeof(chunk_buffer) - length ? n : sizeof(chunk_buffer) - length;
+                memcpy(chunk_buffer + length, (uint8_t *)&header + position, n);
+            }
+            else {
+                n = size - position;
+                n = n < sizeof(chunk_buffer) - length ? n : sizeof(chunk_buffer) - length;
+                size_t ring_position = (tail + position - sizeof(header)) % CONFIG_NFCITY_TRACE_BUFFER_SIZE;
+                ring_peek(ring_position, chunk_buffer + length, n);
+            }
+
+            length += n;
+        }
+
+        if (!cb(chunk_buffer, length, offset, arg)) {
+            completed = false;
+            break;
+        }
+
+        offset += length;
+    }
+
+    lock_take();
+    if (completed) {
+        ring_clear();
+    }
+    dumping = false;
+    lock_give();
+
+    if (out_size != NULL) {
+        *out_size = size;
+    }
+
+    return completed ? ESP_OK : ESP_FAIL;
+}
+
+// }} dumping
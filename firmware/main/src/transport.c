@@ -0,0 +1,93 @@
+#include "esp_log.h"
+#include "esp_check.h"
+#include "dlog.h"
+#include "transport.h"
+
+static const char *TAG = "transport";
+
+static const transport_t *transports[TRANSPORT_COUNT_MAX];
+static size_t transport_count;
+static transport_receiver_t receiver;
+
+// {{ transport
+
+esp_err_t transport_register(const transport_t *transport)
+{
+    ESP_RETURN_ON_FALSE(transport != NULL && transport->send != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid transport");
+    ESP_RETURN_ON_FALSE(transport_count < TRANSPORT_COUNT_MAX, ESP_ERR_NO_MEM, TAG, "too many transports");
+
+    transports[transport_count] = transport;
+    __atomic_store_n(&transport_count, transport_count + 1, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+}
+
+void transport_set_receiver(transport_receiver_t new_receiver)
+{
+    __atomic_store_n(&receiver, new_receiver, __ATOMIC_RELEASE);
+}
+
+void transport_receive(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    transport_receiver_t current_receiver = __atomic_load_n(&receiver, __ATOMIC_ACQUIRE);
+
+    if (current_receiver == NULL) {
+        DLOGW(TAG, "message received with %s dropped, there is no receiver", transport->name);
+        return;
+    }
+
+    current_receiver(transport, data, length);
+}
+
+esp_err_t transport_send(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    if (transport != NULL) {
+        return transport->send(transport, data, length);
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    size_t count = __atomic_load_n(&transport_count, __ATOMIC_ACQUIRE);
+
+    for (size_t i = 0; i < count; i++) {
+        if (transports[i]->send(transports[i], data, length) == ESP_OK) {
+            ret = ESP_OK;
+        }
+    }
+
+    return ret;
+}
+
+// }} transport
+
+// {{ loopback transport
+
+typedef struct
+{
+    transport_loopback_cb_t on_sent;
+    void *arg;
+} loopback_ctx_t;
+
+static loopback_ctx_t loopback_ctx;
+
+static esp_err_t loopback_send(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    loopback_ctx_t *ctx = transport->ctx;
+
+    if (ctx->on_sent != NULL) {
+        ctx->on_sent(data, length, ctx->arg);
+    }
+
+    return ESP_OK;
+}
+
+void transport_loopback_init(transport_t *out_transport, transport_loopback_cb_t on_sent, void *arg)
+{
+    loopback_ctx.on_sent = on_sent;
+    loopback_ctx.arg = arg;
+
+    out_transport->name = "loopback";
+    out_transport->send = loopback_send;
+    out_transport->ctx = &loopback_ctx;
+}
+
+// }} loopback transport
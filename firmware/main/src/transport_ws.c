@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "sdkconfig.h"
+#include "transport.h"
+
+#ifdef CONFIG_NFCITY_LAN_ENABLE
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_http_server.h"
+#include "esp_netif.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "dlog.h"
+
+/*
+ * Websocket endpoint served on the local network, so clients on the same network
+ * do not need the round trip through the broker. Messages are received on the http server task.
+ * Sends come from several tasks (replies, busy replies and broadcasts), so they are serialized by send_mutex.
+ *
+ * Clients authenticate with the token in the query of the handshake (/ws?token=...), sockets
+ * with a missing or wrong token are closed. Replies go to the socket of the request only,
+ * messages sent with the registered transport go to all authenticated clients.
+ */
+
+#define WS_TASK_STACK_SIZE 6144 // messages are dispatched on the server task
+#define WS_FRAME_SIZE_MAX  512 // inbound messages are small, larger frames close the connection
+#define WS_QUERY_SIZE_MAX  64
+#define WS_SEND_TIMEOUT_MS 1000 // of waiting for the send in progress
+
+static const char *TAG = "transport_ws";
+
+static httpd_handle_t server;
+static int clients[CONFIG_NFCITY_LAN_CLIENTS_MAX];
+static portMUX_TYPE clients_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t send_mutex;
+static uint8_t frame_buffer[WS_FRAME_SIZE_MAX];
+static char token[TRANSPORT_WS_TOKEN_LENGTH_MAX + 1];
+
+static esp_err_t ws_send(const transport_t *transport, const uint8_t *data, size_t length);
+
+static const transport_t ws_transport = {
+    .name = "ws",
+    .send = ws_send,
+};
+
+// {{ clients
+
+static bool client_add(int fd)
+{
+    bool added = false;
+
+    taskENTER_CRITICAL(&clients_lock);
+    for (size_t i = 0; i < CONFIG_NFCITY_LAN_CLIENTS_MAX && !added; i++) {
+        if (clients[i] < 0) {
+            clients[i] = fd;
+            added = true;
+        }
+    }
+    taskEXIT_CRITICAL(&clients_lock);
+
+    return added;
+}
+
+static void client_remove(int fd)
+{
+    taskENTER_CRITICAL(&clients_lock);
+    for (size_t i = 0; i < CONFIG_NFCITY_LAN_CLIENTS_MAX; i++) {
+        if (clients[i] == fd) {
+            clients[i] = -1;
+        }
+    }
+    taskEXIT_CRITICAL(&clients_lock);
+}
+
+static bool client_exists(int fd)
+{
+    bool exists = false;
+
+    taskENTER_CRITICAL(&clients_lock);
+    for (size_t i = 0; i < CONFIG_NFCITY_LAN_CLIENTS_MAX && !exists; i++) {
+        exists = clients[i] == fd;
+    }
+    taskEXIT_CRITICAL(&clients_lock);
+
+    return exists;
+}
+
+/**
+ * Compares the token in the query of the handshake, in time which does not depend on the position of a mismatch
+ */
+static bool client_authenticate(httpd_req_t *req)
+{
+    char query[WS_QUERY_SIZE_MAX] = { 0 };
+    char value[TRANSPORT_WS_TOKEN_LENGTH_MAX + 1] = { 0 };
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK
+        || httpd_query_key_value(query, "token", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+
+    size_t length = strlen(token);
+    uint8_t diff = strlen(value) != length;
+
+    for (size_t i = 0; i < length; i++) {
+        diff |= value[i] ^ token[i];
+    }
+
+    return diff == 0;
+}
+
+// }} clients
+
+/**
+ * Sends to the socket in the context of @p transport (reply to a request), or to all clients if there is none.
+ * send_mutex needs to be held.
+ */
+static esp_err_t ws_send_frame(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = (uint8_t *)data,
+        .len = length,
+        .final = true,
+    };
+
+    if (transport->ctx != NULL) {
+        return httpd_ws_send_frame_async(server, *(const int *)transport->ctx, &frame);
+    }
+
+    int fds[CONFIG_NFCITY_LAN_CLIENTS_MAX];
+
+    taskENTER_CRITICAL(&clients_lock);
+    memcpy(fds, clients, sizeof(fds));
+    taskEXIT_CRITICAL(&clients_lock);
+
+    esp_err_t ret = ESP_FAIL;
+
+    for (size_t i = 0; i < CONFIG_NFCITY_LAN_CLIENTS_MAX; i++) {
+        if (fds[i] < 0) {
+            continue;
+        }
+
+        if (httpd_ws_get_fd_info(server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            client_remove(fds[i]);
+            continue;
+        }
+
+        if (httpd_ws_send_frame_async(server, fds[i], &frame) == ESP_OK) {
+            ret = ESP_OK;
+        }
+        else {
+            DLOGW(TAG, "send to client %d failed", fds[i]);
+        }
+    }
+
+    return ret;
+}
+
+static esp_err_t ws_send(const transport_t *transport, const uint8_t *data, size_t length)
+{
+    if (xSemaphoreTake(send_mutex, pdMS_TO_TICKS(WS_SEND_TIMEOUT_MS)) != pdTRUE) {
+        DLOGE(TAG, "Failed to take send_mutex");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ws_send_frame(transport, data, length);
+
+    xSemaphoreGive(send_mutex);
+
+    return ret;
+}
+
+static esp_err_t on_ws_request(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) { // handshake
+        if (!client_authenticate(req)) {
+            ESP_LOGW(TAG, "client %d rejected, invalid token", fd);
+            return ESP_FAIL;
+        }
+        if (!client_add(fd)) {
+            ESP_LOGW(TAG, "client %d rejected, too many clients", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "client %d connected", fd);
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_FALSE(client_exists(fd), ESP_ERR_INVALID_STATE, TAG, "client %d is not authenticated", fd);
+
+    httpd_ws_frame_t frame = { 0 };
+
+    ESP_RETURN_ON_ERROR(httpd_ws_recv_frame(req, &frame, 0), TAG, "Failed to receive frame length");
+
+    if (frame.type != HTTPD_WS_TYPE_BINARY) {
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_FALSE(frame.len <= sizeof(frame_buffer), ESP_ERR_INVALID_SIZE, TAG, "frame is too large");
+
+    frame.payload = frame_buffer;
+    ESP_RETURN_ON_ERROR(httpd_ws_recv_frame(req, &frame, frame.len), TAG, "Failed to receive frame");
+
+    // replies are sent before transport_receive() returns, so the context can live on the stack
+    const transport_t request_transport = {
+        .name = ws_transport.name,
+        .send = ws_send,
+        .ctx = &fd,
+    };
+
+    transport_receive(&request_transport, frame_buffer, frame.len);
+
+    return ESP_OK;
+}
+
+static void on_ws_close(httpd_handle_t handle, int fd)
+{
+    client_remove(fd);
+    close(fd);
+}
+
+esp_err_t transport_ws_start(const char *client_token)
+{
+    ESP_RETURN_ON_FALSE(server == NULL, ESP_ERR_INVALID_STATE, TAG, "already started");
+    ESP_RETURN_ON_FALSE(client_token != NULL && client_token[0] != 0 && strlen(client_token) < sizeof(token),
+        ESP_ERR_INVALID_ARG,
+        TAG,
+        "invalid token");
+
+    strcpy(token, client_token);
+
+    if (send_mutex == NULL) {
+        send_mutex = xSemaphoreCreateMutex();
+        ESP_RETURN_ON_FALSE(send_mutex != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create send_mutex");
+    }
+
+    for (size_t i = 0; i < CONFIG_NFCITY_LAN_CLIENTS_MAX; i++) {
+        clients[i] = -1;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONFIG_NFCITY_LAN_PORT;
+    config.ctrl_port = CONFIG_NFCITY_LAN_PORT + 1;
+    config.stack_size = WS_TASK_STACK_SIZE;
+    config.max_open_sockets = CONFIG_NFCITY_LAN_CLIENTS_MAX + 1;
+    config.close_fn = on_ws_close;
+
+    ESP_RETURN_ON_ERROR(httpd_start(&server, &config), TAG, "Failed to start http server");
+
+    const httpd_uri_t ws_uri = {
+        .uri = TRANSPORT_WS_PATH,
+        .method = HTTP_GET,
+        .handler = on_ws_request,
+        .is_websocket = true,
+    };
+
+    esp_err_t ret = ESP_OK;
+
+    ESP_GOTO_ON_ERROR(httpd_register_uri_handler(server, &ws_uri), _exit, TAG, "Failed to register endpoint");
+    ESP_GOTO_ON_ERROR(transport_register(&ws_transport), _exit, TAG, "Failed to register transport");
+
+    return ESP_OK;
+
+_exit:
+    httpd_stop(server);
+    server = NULL;
+
+    return ret;
+}
+
+esp_err_t transport_ws_get_url(char *out_url, size_t size)
+{
+    ESP_RETURN_ON_FALSE(server != NULL, ESP_ERR_INVALID_STATE, TAG, "not started");
+
+    esp_netif_t *netif = esp_netif_get_default_netif();
+    ESP_RETURN_ON_FALSE(netif != NULL, ESP_ERR_INVALID_STATE, TAG, "no network interface");
+
+    esp_netif_ip_info_t ip_info = { 0 };
+    ESP_RETURN_ON_ERROR(esp_netif_get_ip_info(netif, &ip_info), TAG, "Failed to get ip info");
+
+    int length = snprintf(out_url,
+        size,
+        "ws://" IPSTR ":%d" TRANSPORT_WS_PATH,
+        IP2STR(&ip_info.ip),
+        CONFIG_NFCITY_LAN_PORT);
+
+    return length > 0 && (size_t)length < size ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+#else // lan endpoint is disabled, or websockets are not supported by the http server
+
+esp_err_t transport_ws_start(const char *client_token)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t transport_ws_get_url(char *out_url, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
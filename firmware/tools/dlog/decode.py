@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Formats raw deferred log records (see main/include/dlog.h) captured from the device.
+
+Format strings and tags are not part of the records, they are read from the firmware elf by their addresses,
+so the elf has to be the one of the firmware which produced the records.
+
+Usage: decode.py build/nfcity.elf nfcity-log.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+RECORD_HEADER = struct.Struct("<IIIBBH")  # dlog_record_t
+LEVEL_LETTERS = "NEWIDV"
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d*))?(hh|h|ll|l|z|j|t)?([diouxXcfFeEgGaAsp%])")
+
+# sizes of the arguments on the device (ILP32)
+INT_SIZES = {None: 4, "hh": 4, "h": 4, "l": 4, "ll": 8, "z": 4, "j": 8, "t": 4}
+INT_MASKS = {"hh": 0xFF, "h": 0xFFFF}
+INT_FORMATS = {(4, True): "<i", (4, False): "<I", (8, True): "<q", (8, False): "<Q"}
+
+
+class Strings:
+    def __init__(self, elf_path):
+        self.segments = []
+        with open(elf_path, "rb") as elf_file:
+            elf = ELFFile(elf_file)
+            for section in elf.iter_sections():
+                if section["sh_addr"] and section["sh_type"] == "SHT_PROGBITS":
+                    self.segments.append((section["sh_addr"], section.data()))
+        self.cache = {}
+
+    def get(self, address):
+        if address not in self.cache:
+            self.cache[address] = self._read(address)
+        return self.cache[address]
+
+    def _read(self, address):
+        for start, data in self.segments:
+            if start <= address < start + len(data):
+                end = data.find(b"\0", address - start)
+                return data[address - start : end if end >= 0 else len(data)].decode("utf-8", "replace")
+        return "<0x%08x>" % address
+
+
+def format_args(format, args):
+    """Mirrors args_format() of the firmware, conversions without arguments are printed as they are"""
+    out = []
+    offset = 0
+    position = 0
+
+    for match in CONVERSION.finditer(format):
+        out.append(format[position : match.start()])
+        position = match.end()
+        flags, width, precision, length, conversion = match.groups()
+
+        if conversion == "%":
+            out.append("%")
+            continue
+
+        spec = "%" + flags + width + ("." + precision if precision is not None else "")
+
+        try:
+            if conversion == "s":
+                size = args[offset]
+                value = args[offset + 1 : offset + 1 + size]
+                if len(value) != size:
+                    raise IndexError
+                offset += 1 + size
+                out.append((spec + "s") % value.decode("utf-8", "replace"))
+            elif conversion in "fFeEgGaA":
+                (value,) = struct.unpack_from("<d", args, offset)
+                offset += 8
+                out.append((spec + (conversion if conversion not in "aA" else "e")) % value)
+            elif conversion == "p":
+                (value,) = struct.unpack_from("<I", args, offset)
+                offset += 4
+                out.append("0x%x" % value)
+            else:
+                size = INT_SIZES[length]
+                signed = conversion in "di"
+                (value,) = struct.unpack_from(INT_FORMATS[(size, signed)], args, offset)
+                offset += size
+                if length in INT_MASKS:
+                    value &= INT_MASKS[length]
+                    if signed and value > INT_MASKS[length] >> 1:
+                        value -= INT_MASKS[length] + 1
+                out.append((spec + ("d" if conversion in "iu" else conversion)) % value)
+        except (IndexError, struct.error):
+            offset = len(args)  # following arguments can't be located
+            out.append(match.group(0))
+
+    out.append(format[position:])
+
+    return "".join(out)
+
+
+def decode(strings, data):
+    offset = 0
+
+    while offset + RECORD_HEADER.size <= len(data):
+        format, tag, timestamp_ms, level, core, args_size = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        args = data[offset : offset + args_size]
+        offset += args_size
+
+        letter = LEVEL_LETTERS[level] if level < len(LEVEL_LETTERS) else "?"
+        message = format_args(strings.get(format), args)
+        yield "%s (%d) [%d] %s: %s" % (letter, timestamp_ms, core, strings.get(tag), message)
+
+    if offset != len(data):
+        print("warning: %d trailing bytes" % (len(data) - offset), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Formats raw deferred log records of the device")
+    parser.add_argument("elf", help="firmware elf which produced the records (build/nfcity.elf)")
+    parser.add_argument("records", help="captured records (nfcity-log.bin)")
+    args = parser.parse_args()
+
+    strings = Strings(args.elf)
+    with open(args.records, "rb") as records_file:
+        for line in decode(strings, records_file.read()):
+            print(line)
+
+
+if __name__ == "__main__":
+    main()
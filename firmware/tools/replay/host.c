@@ -0,0 +1,289 @@
+#include <stdarg.h>
+#include "host.h"
+
+/*
+ * Inert implementations of the platform functions which are linked into the firmware,
+ * but are not exercised by the replay (connectivity, tasks, flash) or are pure (crc, sector layout).
+ */
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+static const char host_log_letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+void host_log(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > host_log_level || level == ESP_LOG_NONE) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", host_log_letters[level], tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > host_log_level || level == ESP_LOG_NONE) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+// {{ freertos
+
+static int host_handle; // address serves as a non-null handle
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return &host_handle;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code,
+    const char *name,
+    uint32_t stack_depth,
+    void *parameters,
+    UBaseType_t priority,
+    TaskHandle_t *created_task)
+{
+    return pdFAIL;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait)
+{
+    return 0;
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return &host_handle;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t event_group, EventBits_t bits)
+{
+    return 0;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t event_group, EventBits_t bits)
+{
+    return bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t event_group,
+    EventBits_t bits,
+    BaseType_t clear_on_exit,
+    BaseType_t wait_for_all,
+    TickType_t ticks_to_wait)
+{
+    return bits;
+}
+
+// }} freertos
+
+// {{ esp_random, esp_rom_crc
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *buf_ptr = buf;
+
+    for (size_t i = 0; i < len; i++) {
+        buf_ptr[i] = (uint8_t)rand();
+    }
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+// }} esp_random, esp_rom_crc
+
+// {{ esp_partition
+
+const esp_partition_t *esp_partition_find_first(
+    esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// }} esp_partition
+
+// {{ esp_event, esp_netif, esp_wifi, nvs, protocol_examples_common
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t example_connect(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+// }} esp_event, esp_netif, esp_wifi, nvs, protocol_examples_common
+
+// {{ mqtt_client
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    return NULL;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+    esp_mqtt_event_id_t event,
+    esp_event_handler_t event_handler,
+    void *event_handler_arg)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int esp_mqtt_client_subscribe_single(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    return -1;
+}
+
+int esp_mqtt_client_publish(
+    esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int retain)
+{
+    return -1;
+}
+
+// }} mqtt_client
+
+// {{ rc522
+
+esp_err_t rc522_spi_create(const rc522_spi_config_t *config, rc522_driver_handle_t *driver)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t rc522_driver_install(rc522_driver_handle_t driver)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t rc522_create(const rc522_config_t *config, rc522_handle_t *out_rc522)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t rc522_register_events(
+    rc522_handle_t rc522, rc522_event_t event, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t rc522_start(rc522_handle_t rc522)
+{
+    return ESP_OK;
+}
+
+esp_err_t rc522_pause(rc522_handle_t rc522)
+{
+    return ESP_OK;
+}
+
+esp_err_t rc522_mifare_get_sector_desc(uint8_t sector_index, rc522_mifare_sector_desc_t *out_sector_desc)
+{
+    if (sector_index >= 40) { // Mifare 4K
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    out_sector_desc->index = sector_index;
+
+    if (sector_index < 32) {
+        out_sector_desc->number_of_blocks = 4;
+        out_sector_desc->block_0_address = sector_index * 4;
+    }
+    else {
+        out_sector_desc->number_of_blocks = 16;
+        out_sector_desc->block_0_address = 128 + (sector_index - 32) * 16;
+    }
+
+    return ESP_OK;
+}
+
+// }} rc522
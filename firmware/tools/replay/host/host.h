@@ -0,0 +1,454 @@
+#pragma once
+
+/*
+ * Minimal host replacements of ESP-IDF, FreeRTOS, MQTT and rc522 APIs used by the firmware,
+ * just enough to build the firmware handlers on host. Every IDF header included by the firmware
+ * is an alias of this header. Behavior (clock, RF and publishing) is provided by the replayer.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include "sdkconfig.h"
+
+#define likely(x)   __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define BIT0        (1 << 0)
+
+// {{ esp_err
+
+typedef int esp_err_t;
+
+#define ESP_OK                0
+#define ESP_FAIL              -1
+#define ESP_ERR_NO_MEM        0x101
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE  0x104
+#define ESP_ERR_NOT_FOUND     0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT       0x107
+#define ESP_ERR_INVALID_CRC   0x109
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+#define ESP_ERROR_CHECK(x)                                                                                             \
+    do {                                                                                                               \
+        esp_err_t err_rc_ = (x);                                                                                       \
+        if (err_rc_ != ESP_OK) {                                                                                       \
+            fprintf(stderr, "%s:%d: %s => %d\n", __FILE__, __LINE__, #x, err_rc_);                                     \
+            abort();                                                                                                   \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+// }} esp_err
+
+// {{ esp_log
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+/**
+ * Messages above this level are not printed
+ */
+extern esp_log_level_t host_log_level;
+
+void host_log(esp_log_level_t level, const char *tag, const char *format, ...);
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...); // without prefix
+
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...) host_log(level, tag, format, ##__VA_ARGS__)
+#define ESP_LOGE(tag, format, ...)                   host_log(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)                   host_log(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)                   host_log(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)                   host_log(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)                   host_log(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#define LOG_LOCAL_LEVEL                              ESP_LOG_VERBOSE // filtered by host_log
+#define esp_log_write                                host_log_write
+
+// }} esp_log
+
+// {{ esp_check
+
+#define ESP_RETURN_ON_ERROR(x, log_tag, format, ...)                                                                   \
+    do {                                                                                                               \
+        esp_err_t err_rc_ = (x);                                                                                       \
+        if (unlikely(err_rc_ != ESP_OK)) {                                                                             \
+            ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__);                               \
+            return err_rc_;                                                                                            \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+#define ESP_RETURN_ON_FALSE(a, err_code, log_tag, format, ...)                                                         \
+    do {                                                                                                               \
+        if (unlikely(!(a))) {                                                                                          \
+            ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__);                               \
+            return err_code;                                                                                           \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+#define ESP_GOTO_ON_ERROR(x, goto_tag, log_tag, format, ...)                                                           \
+    do {                                                                                                               \
+        esp_err_t err_rc_ = (x);                                                                                       \
+        if (unlikely(err_rc_ != ESP_OK)) {                                                                             \
+            ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__);                               \
+            ret = err_rc_;                                                                                             \
+            goto goto_tag;                                                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+#define ESP_GOTO_ON_FALSE(a, err_code, goto_tag, log_tag, format, ...)                                                 \
+    do {                                                                                                               \
+        if (unlikely(!(a))) {                                                                                          \
+            ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__);                               \
+            ret = err_code;                                                                                            \
+            goto goto_tag;                                                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+// }} esp_check
+
+// {{ freertos
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t EventBits_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void *EventGroupHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define portMAX_DELAY     ((TickType_t)0xffffffffUL)
+#define pdTRUE            ((BaseType_t)1)
+#define pdFALSE           ((BaseType_t)0)
+#define pdPASS            pdTRUE
+#define pdFAIL            pdFALSE
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// replay runs on a single core, without interrupts
+#define portNUM_PROCESSORS                      1
+#define xPortGetCoreID()                        0
+#define portSET_INTERRUPT_MASK_FROM_ISR()       0
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(mask) (void)(mask)
+
+// replay is single threaded, so mutexes are always available
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+BaseType_t xTaskCreate(TaskFunction_t task_code,
+    const char *name,
+    uint32_t stack_depth,
+    void *parameters,
+    UBaseType_t priority,
+    TaskHandle_t *created_task);
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait);
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t event_group, EventBits_t bits);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t event_group, EventBits_t bits);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t event_group,
+    EventBits_t bits,
+    BaseType_t clear_on_exit,
+    BaseType_t wait_for_all,
+    TickType_t ticks_to_wait);
+
+// }} freertos
+
+// {{ esp_timer, esp_random, esp_rom_crc
+
+/**
+ * Virtual clock of the replay
+ */
+int64_t esp_timer_get_time(void);
+
+void esp_fill_random(void *buf, size_t len);
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+// }} esp_timer, esp_random, esp_rom_crc
+
+// {{ esp_partition
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct
+{
+    esp_partition_type_t type;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(
+    esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+// }} esp_partition
+
+// {{ esp_event, esp_netif, esp_wifi, nvs, protocol_examples_common
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(
+    void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+#define ESP_EVENT_ANY_ID -1
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_netif_init(void);
+esp_err_t example_connect(void);
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+// }} esp_event, esp_netif, esp_wifi, nvs, protocol_examples_common
+
+// {{ mqtt_client
+
+typedef enum
+{
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+    MQTT_EVENT_DELETED,
+    MQTT_USER_EVENT,
+} esp_mqtt_event_id_t;
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef struct
+{
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    char *data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+    char *topic;
+    int topic_len;
+    int msg_id;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+typedef struct
+{
+    struct
+    {
+        struct
+        {
+            const char *uri;
+        } address;
+        struct
+        {
+            const char *certificate;
+            size_t certificate_len;
+        } verification;
+    } broker;
+    struct
+    {
+        const char *username;
+        struct
+        {
+            const char *password;
+        } authentication;
+    } credentials;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+    esp_mqtt_event_id_t event,
+    esp_event_handler_t event_handler,
+    void *event_handler_arg);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+int esp_mqtt_client_subscribe_single(esp_mqtt_client_handle_t client, const char *topic, int qos);
+
+/**
+ * Outbound messages are captured by the replayer
+ */
+int esp_mqtt_client_publish(
+    esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int retain);
+
+// }} mqtt_client
+
+// {{ rc522
+
+#define RC522_PICC_UID_SIZE_MAX 10
+#define RC522_MIFARE_KEY_SIZE   6
+#define RC522_MIFARE_BLOCK_SIZE 16
+
+typedef struct rc522 *rc522_handle_t;
+typedef struct rc522_driver *rc522_driver_handle_t;
+
+typedef enum
+{
+    RC522_PICC_STATE_IDLE = 0,
+    RC522_PICC_STATE_READY,
+    RC522_PICC_STATE_ACTIVE,
+    RC522_PICC_STATE_HALT,
+    RC522_PICC_STATE_READY_H,
+    RC522_PICC_STATE_ACTIVE_H,
+} rc522_picc_state_t;
+
+typedef enum
+{
+    RC522_PICC_TYPE_UNKNOWN = -1,
+    RC522_PICC_TYPE_UNDEFINED = 0,
+} rc522_picc_type_t;
+
+typedef struct
+{
+    uint8_t value[RC522_PICC_UID_SIZE_MAX];
+    uint8_t length;
+} rc522_picc_uid_t;
+
+typedef struct
+{
+    uint16_t source;
+} rc522_picc_atqa_desc_t;
+
+typedef struct
+{
+    rc522_picc_atqa_desc_t atqa;
+    rc522_picc_uid_t uid;
+    uint8_t sak;
+    rc522_picc_type_t type;
+    rc522_picc_state_t state;
+} rc522_picc_t;
+
+typedef struct
+{
+    rc522_picc_t *picc;
+    rc522_picc_state_t old_state;
+} rc522_picc_state_changed_event_t;
+
+typedef enum
+{
+    RC522_EVENT_ANY = -1,
+    RC522_EVENT_NONE,
+    RC522_EVENT_PICC_STATE_CHANGED,
+} rc522_event_t;
+
+typedef struct
+{
+    rc522_driver_handle_t driver;
+    uint16_t poll_interval_ms;
+    uint32_t task_stack_size;
+    uint32_t task_priority;
+    SemaphoreHandle_t task_mutex;
+} rc522_config_t;
+
+typedef enum
+{
+    SPI1_HOST = 0,
+    SPI2_HOST = 1,
+    SPI3_HOST = 2,
+} spi_host_device_t;
+
+typedef struct
+{
+    int miso_io_num;
+    int mosi_io_num;
+    int sclk_io_num;
+} spi_bus_config_t;
+
+typedef struct
+{
+    int spics_io_num;
+} spi_device_interface_config_t;
+
+typedef struct
+{
+    spi_host_device_t host_id;
+    spi_bus_config_t *bus_config;
+    spi_device_interface_config_t dev_config;
+    int rst_io_num;
+} rc522_spi_config_t;
+
+esp_err_t rc522_spi_create(const rc522_spi_config_t *config, rc522_driver_handle_t *driver);
+esp_err_t rc522_driver_install(rc522_driver_handle_t driver);
+esp_err_t rc522_create(const rc522_config_t *config, rc522_handle_t *out_rc522);
+esp_err_t rc522_register_events(
+    rc522_handle_t rc522, rc522_event_t event, esp_event_handler_t event_handler, void *event_handler_arg);
+esp_err_t rc522_start(rc522_handle_t rc522);
+esp_err_t rc522_pause(rc522_handle_t rc522);
+
+typedef enum
+{
+    RC522_MIFARE_KEY_A = 0,
+    RC522_MIFARE_KEY_B = 1,
+} rc522_mifare_key_type_t;
+
+typedef struct
+{
+    rc522_mifare_key_type_t type;
+    uint8_t value[RC522_MIFARE_KEY_SIZE];
+} rc522_mifare_key_t;
+
+typedef struct
+{
+    uint8_t index;
+    uint8_t number_of_blocks;
+    uint8_t block_0_address;
+} rc522_mifare_sector_desc_t;
+
+esp_err_t rc522_mifare_get_sector_desc(uint8_t sector_index, rc522_mifare_sector_desc_t *out_sector_desc);
+
+/*
+ * Calls are answered from the trace by the replayer
+ */
+esp_err_t rc522_mifare_auth(
+    rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, const rc522_mifare_key_t *key);
+esp_err_t rc522_mifare_auth_sector(
+    rc522_handle_t rc522, rc522_picc_t *picc, rc522_mifare_sector_desc_t *sector_desc, const rc522_mifare_key_t *key);
+esp_err_t rc522_mifare_read(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, uint8_t *out_buffer);
+esp_err_t rc522_mifare_write(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, const uint8_t *buffer);
+esp_err_t rc522_mifare_deauth(rc522_handle_t rc522, rc522_picc_t *picc);
+
+// }} rc522
@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+ * Firmware configuration used by the replay. Mirrors the Kconfig defaults, except for:
+ * - tracing, since the replay itself is fed by the trace
+ * - serving reads from snapshots, since the replay does not have the flash content of the recording device
+ */
+
+#define CONFIG_NFCITY_MQTT_BROKER                     "wss://broker.emqx.io:8084/mqtt"
+#define CONFIG_NFCITY_RF_POLL_AGGRESSIVE_INTERVAL_MS  50
+#define CONFIG_NFCITY_RF_SCHED_ENABLE                 1
+#define CONFIG_NFCITY_RF_POLL_IDLE_INTERVAL_MS        500
+#define CONFIG_NFCITY_RF_SCHED_SCAN_WINDOW_MS         120
+#define CONFIG_NFCITY_RF_POLL_AGGRESSIVE_HOLD_MS      10000
+#define CONFIG_NFCITY_RF_POLL_WEB_ACTIVITY_TIMEOUT_MS 7500
+#define CONFIG_NFCITY_RF_SCHED_STATS_LOG_INTERVAL_MS  0
+#define CONFIG_NFCITY_SNAPSHOT_ENABLE                 1
+#define CONFIG_NFCITY_SNAPSHOT_CAPACITY               16
+#define CONFIG_NFCITY_READ_COALESCE_WINDOW_MS         300
+#define CONFIG_NFCITY_BROADCAST_BLOCK_CHANGES         1
+#define CONFIG_NFCITY_TRACE_BUFFER_SIZE               16384
+#define CONFIG_NFCITY_REPLY_TIMING                    1
+#define CONFIG_NFCITY_DLOG_ENABLE                     1
+#define CONFIG_NFCITY_DLOG_RING_SIZE                  2048
+#define CONFIG_NFCITY_DLOG_FLUSH_INTERVAL_MS          100
+
+#define CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY        1
@@ -0,0 +1,715 @@
+#include <time.h>
+#include "host.h"
+
+/*
+ * Firmware is built in, so its static handlers are fed directly with the recorded events.
+ */
+#include "nfcity.c"
+
+/*
+ * Replays a trace recorded by the firmware (see trace.h) through the handlers of this firmware revision.
+ *
+ * Virtual clock follows the recorded timeline: it jumps to the arrival time of each recorded event,
+ * progresses with the host time while the handlers run, and by the recorded duration of each RF call.
+ * RF calls are answered with the recorded results and data, matched by operation and address
+ * among the calls recorded for the same event. Published messages are compared with the recorded ones by their
+ * digest (see trace_mqtt_out_digest()).
+ *
+ * Writes CSV with per-stage timings of each event to stdout, and a summary to stderr.
+ */
+
+#define REPLAY_TIMELINE_START_US 1000000 // zero is used as "no time" by the firmware
+#define REPLAY_KIND_LENGTH       24
+#define REPLAY_KINDS_MAX         16
+#define REPLAY_LINE_LENGTH       512
+#define REPLAY_COLUMNS           (2 + 2 * STAGE_MAX + 6) // see report_csv()
+
+typedef enum
+{
+    STAGE_QUEUE = 0, // arrival to the start of the handler
+    STAGE_RF, // RF calls
+    STAGE_CPU, // handler, without RF calls
+    STAGE_REPLY, // arrival to the first publish
+    STAGE_TOTAL, // arrival to the end of the handler
+    STAGE_MAX,
+} stage_t;
+
+static const char *stage_names[STAGE_MAX] = {
+    [STAGE_QUEUE] = "queue",
+    [STAGE_RF] = "rf",
+    [STAGE_CPU] = "cpu",
+    [STAGE_REPLY] = "reply",
+    [STAGE_TOTAL] = "total",
+};
+
+typedef struct
+{
+    uint8_t type;
+    int64_t time_us; // since the start of the trace
+    const uint8_t *payload;
+    uint16_t length;
+} record_t;
+
+typedef struct
+{
+    size_t index;
+    char kind[REPLAY_KIND_LENGTH];
+    int64_t stages[STAGE_MAX]; // negative if not available
+    uint32_t rf; // number of RF calls (matched by replay)
+    uint32_t out; // number of published messages (matched by replay)
+} row_t;
+
+typedef struct
+{
+    size_t first; // MQTT_IN or PICC record which starts the group
+    size_t end;
+    row_t recorded;
+    row_t replayed;
+    uint32_t rf_issued;
+    uint32_t out_issued;
+    size_t rf_cursor;
+    size_t out_cursor;
+    int64_t arrival_us;
+} group_t;
+
+static record_t *records;
+static size_t record_count;
+static group_t *groups;
+static size_t group_count;
+static group_t *current; // group being replayed
+static int64_t clock_offset_us;
+static int64_t rf_mean_us[TRACE_RF_DEAUTH + 1];
+static transport_t replay_transport; // inbound messages are injected, outbound ones are matched with the trace
+
+static const char *web_msg_kind_names[] = {
+    [WEB_MSG_UNDEFINED] = "undefined",
+    [WEB_MSG_PING] = "ping",
+    [WEB_MSG_GET_PICC] = "get_picc",
+    [WEB_MSG_READ_SECTOR] = "read_sector",
+    [WEB_MSG_WRITE_BLOCK] = "write_block",
+    [WEB_MSG_GET_SNAPSHOTS] = "get_snapshots",
+    [WEB_MSG_GET_TRACE] = "get_trace",
+    [WEB_MSG_HELLO] = "hello",
+    [WEB_MSG_GET_RF_STATS] = "get_rf_stats",
+};
+
+// {{ clock
+
+static int64_t host_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us() + clock_offset_us;
+}
+
+static void clock_advance(int64_t us)
+{
+    clock_offset_us += us;
+}
+
+static void clock_jump(int64_t time_us)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (time_us > now_us) {
+        clock_advance(time_us - now_us);
+    }
+}
+
+// }} clock
+
+// {{ trace
+
+static bool trace_load(const uint8_t *buffer, size_t size)
+{
+    trace_header_t header;
+
+    if (size < sizeof(header)) {
+        fprintf(stderr, "trace is too short\n");
+        return false;
+    }
+
+    memcpy(&header, buffer, sizeof(header));
+
+    if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.header_size < sizeof(header)) {
+        fprintf(stderr, "unsupported trace (magic=0x%08" PRIx32 ", version=%d)\n", header.magic, header.version);
+        return false;
+    }
+
+    if (header.dropped > 0) {
+        fprintf(stderr, "%" PRIu32 " records were dropped by the firmware, first events might be incomplete\n",
+            header.dropped);
+    }
+
+    const uint8_t *ptr = buffer + header.header_size;
+    const uint8_t *end = ptr + header.size;
+    int64_t time_us = 0;
+    size_t capacity = 0;
+
+    if (end > buffer + size) {
+        fprintf(stderr, "trace is truncated\n");
+        end = buffer + size;
+    }
+
+    while (ptr + sizeof(trace_record_header_t) <= end) {
+        trace_record_header_t record_header;
+        memcpy(&record_header, ptr, sizeof(record_header));
+        ptr += sizeof(record_header);
+
+        if (ptr + record_header.length > end) {
+            fprintf(stderr, "last record is truncated\n");
+            break;
+        }
+
+        if (record_count == capacity) {
+            capacity = capacity == 0 ? 256 : capacity * 2;
+            records = realloc(records, capacity * sizeof(record_t));
+            assert(records != NULL);
+        }
+
+        time_us += record_header.delta_us;
+        records[record_count++] = (record_t){
+            .type = record_header.type,
+            .time_us = time_us,
+            .payload = ptr,
+            .length = record_header.length,
+        };
+
+        ptr += record_header.length;
+    }
+
+    return true;
+}
+
+static const char *record_kind(const record_t *record)
+{
+    if (record->type == TRACE_RECORD_PICC) {
+        return "picc_state";
+    }
+
+    web_msg_t msg = { 0 };
+    if (dec_msg(record->payload, record->length, &msg) != CborNoError || msg.kind < 0
+        || msg.kind >= (int)(sizeof(web_msg_kind_names) / sizeof(web_msg_kind_names[0]))) {
+        return "unknown";
+    }
+
+    return web_msg_kind_names[msg.kind];
+}
+
+static void group_close(group_t *group)
+{
+    const record_t *first = &records[group->first];
+    int64_t last_us = first->time_us;
+
+    group->recorded.stages[STAGE_QUEUE] = 0; // not observable on the device
+    group->recorded.stages[STAGE_RF] = 0;
+    group->recorded.stages[STAGE_REPLY] = -1;
+
+    for (size_t i = group->first + 1; i < group->end; i++) {
+        const record_t *record = &records[i];
+        last_us = record->time_us;
+
+        if (record->type == TRACE_RECORD_RF && record->length >= sizeof(trace_rf_t)) {
+            trace_rf_t rf;
+            memcpy(&rf, record->payload, sizeof(rf));
+            group->recorded.stages[STAGE_RF] += rf.duration_us;
+            group->recorded.rf++;
+        }
+        else if (record->type == TRACE_RECORD_MQTT_OUT) {
+            if (group->recorded.out++ == 0) {
+                group->recorded.stages[STAGE_REPLY] = record->time_us - first->time_us;
+            }
+        }
+    }
+
+    group->recorded.stages[STAGE_TOTAL] = last_us - first->time_us;
+    group->recorded.stages[STAGE_CPU] = group->recorded.stages[STAGE_TOTAL] - group->recorded.stages[STAGE_RF];
+}
+
+static void groups_build()
+{
+    int64_t rf_sum_us[TRACE_RF_DEAUTH + 1] = { 0 };
+    uint32_t rf_count[TRACE_RF_DEAUTH + 1] = { 0 };
+
+    groups = calloc(record_count > 0 ? record_count : 1, sizeof(group_t));
+    assert(groups != NULL);
+
+    for (size_t i = 0; i < record_count; i++) {
+        const record_t *record = &records[i];
+
+        switch (record->type) {
+            case TRACE_RECORD_MQTT_IN:
+            case TRACE_RECORD_PICC: {
+                if (group_count > 0) {
+                    group_close(&groups[group_count - 1]);
+                }
+                group_t *group = &groups[group_count];
+                group->first = i;
+                group->end = i + 1;
+                group->recorded.index = group->replayed.index = group_count;
+                snprintf(group->recorded.kind, REPLAY_KIND_LENGTH, "%s", record_kind(record));
+                memcpy(group->replayed.kind, group->recorded.kind, REPLAY_KIND_LENGTH);
+                group_count++;
+            } break;
+            case TRACE_RECORD_RF: {
+                trace_rf_t rf;
+                if (record->length >= sizeof(rf)) {
+                    memcpy(&rf, record->payload, sizeof(rf));
+                    if (rf.op <= TRACE_RF_DEAUTH) {
+                        rf_sum_us[rf.op] += rf.duration_us;
+                        rf_count[rf.op]++;
+                    }
+                }
+            } // fallthrough
+            default: {
+                if (group_count > 0) { // records preceding the first event are not attributable
+                    groups[group_count - 1].end = i + 1;
+                }
+            } break;
+        }
+    }
+
+    if (group_count > 0) {
+        group_close(&groups[group_count - 1]);
+    }
+
+    for (uint8_t op = 0; op <= TRACE_RF_DEAUTH; op++) {
+        rf_mean_us[op] = rf_count[op] > 0 ? rf_sum_us[op] / rf_count[op] : 0;
+    }
+}
+
+// }} trace
+
+// {{ simulated platform
+
+static esp_err_t rf_replay(trace_rf_op_t op, uint8_t address, uint8_t *out_data)
+{
+    if (current == NULL) {
+        return ESP_FAIL;
+    }
+
+    current->rf_issued++;
+
+    for (size_t i = current->rf_cursor; i < current->end; i++) {
+        const record_t *record = &records[i];
+        trace_rf_t rf;
+
+        if (record->type != TRACE_RECORD_RF || record->length < sizeof(rf)) {
+            continue;
+        }
+
+        memcpy(&rf, record->payload, sizeof(rf));
+
+        if (rf.op != op || rf.address != address) {
+            continue;
+        }
+
+        current->rf_cursor = i + 1;
+        current->replayed.rf++;
+        current->replayed.stages[STAGE_RF] += rf.duration_us;
+        clock_advance(rf.duration_us);
+
+        if (out_data != NULL && rf.result == ESP_OK && record->length >= sizeof(rf) + RC522_MIFARE_BLOCK_SIZE) {
+            memcpy(out_data, record->payload + sizeof(rf), RC522_MIFARE_BLOCK_SIZE);
+        }
+
+        return rf.result;
+    }
+
+    // call was not made by the recorded revision, so neither its result nor the card content is known
+    ESP_LOGI("replay", "event %zu: unmatched rf call (op=%d, address=%d)", current->replayed.index, op, address);
+    current->replayed.stages[STAGE_RF] += rf_mean_us[op];
+    clock_advance(rf_mean_us[op]);
+
+    return ESP_FAIL;
+}
+
+esp_err_t rc522_mifare_auth(
+    rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, const rc522_mifare_key_t *key)
+{
+    return rf_replay(TRACE_RF_AUTH, block_address, NULL);
+}
+
+esp_err_t rc522_mifare_auth_sector(
+    rc522_handle_t rc522, rc522_picc_t *picc, rc522_mifare_sector_desc_t *sector_desc, const rc522_mifare_key_t *key)
+{
+    return rf_replay(TRACE_RF_AUTH_SECTOR, sector_desc->index, NULL);
+}
+
+esp_err_t rc522_mifare_read(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, uint8_t *out_buffer)
+{
+    return rf_replay(TRACE_RF_READ, block_address, out_buffer);
+}
+
+esp_err_t rc522_mifare_write(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t block_address, const uint8_t *buffer)
+{
+    return rf_replay(TRACE_RF_WRITE, block_address, NULL);
+}
+
+esp_err_t rc522_mifare_deauth(rc522_handle_t rc522, rc522_picc_t *picc)
+{
+    return rf_replay(TRACE_RF_DEAUTH, 0, NULL);
+}
+
+static void on_replay_out(const uint8_t *data, size_t length, void *arg)
+{
+    if (current == NULL) {
+        return;
+    }
+
+    if (current->out_issued++ == 0) {
+        current->replayed.stages[STAGE_REPLY] = esp_timer_get_time() - current->arrival_us;
+    }
+
+    trace_mqtt_out_t digest = { 0 };
+    trace_mqtt_out_digest(data, length, &digest);
+
+    for (size_t i = current->out_cursor; i < current->end; i++) {
+        const record_t *record = &records[i];
+        trace_mqtt_out_t out;
+
+        if (record->type != TRACE_RECORD_MQTT_OUT || record->length < sizeof(out)) {
+            continue;
+        }
+
+        memcpy(&out, record->payload, sizeof(out));
+
+        if (out.crc == digest.crc && out.length == digest.length) {
+            current->out_cursor = i + 1;
+            current->replayed.out++;
+            break;
+        }
+    }
+}
+
+// }} simulated platform
+
+// {{ replay
+
+static void replay_init()
+{
+    wait_bits = xEventGroupCreate();
+    enc_buffer_mutex = xSemaphoreCreateMutex();
+    rc522_task_mutex = xSemaphoreCreateMutex();
+    strcpy(mqtt_topic_buffer, "/replay");
+    mqtt_subtopic_ptr = mqtt_topic_buffer + strlen(mqtt_topic_buffer);
+    clock_offset_us = REPLAY_TIMELINE_START_US - host_time_us();
+
+    transport_loopback_init(&replay_transport, on_replay_out, NULL);
+    transport_register(&replay_transport);
+    transport_set_receiver(on_web_data);
+}
+
+static void replay_picc(const record_t *record)
+{
+    trace_picc_t p = { 0 };
+    memcpy(&p, record->payload, record->length < sizeof(p) ? record->length : sizeof(p));
+
+    rc522_picc_t event_picc = {
+        .atqa.source = p.atqa,
+        .sak = p.sak,
+        .type = p.type,
+        .state = p.state,
+        .uid.length = p.uid_length <= RC522_PICC_UID_SIZE_MAX ? p.uid_length : RC522_PICC_UID_SIZE_MAX,
+    };
+
+    memcpy(event_picc.uid.value, p.uid, event_picc.uid.length);
+
+    rc522_picc_state_changed_event_t event = {
+        .picc = &event_picc,
+        .old_state = p.old_state,
+    };
+
+    on_picc_state_changed(NULL, NULL, RC522_EVENT_PICC_STATE_CHANGED, &event);
+}
+
+static void replay_mqtt_in(const record_t *record)
+{
+    transport_receive(&replay_transport, record->payload, record->length);
+}
+
+static void replay_group(group_t *group)
+{
+    const record_t *first = &records[group->first];
+
+    current = group;
+    group->rf_cursor = group->out_cursor = group->first + 1;
+    group->arrival_us = REPLAY_TIMELINE_START_US + first->time_us;
+    group->replayed.stages[STAGE_REPLY] = -1;
+
+    clock_jump(group->arrival_us);
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t host_start_us = host_time_us();
+
+    if (first->type == TRACE_RECORD_PICC) {
+        replay_picc(first);
+    }
+    else {
+        replay_mqtt_in(first);
+    }
+
+    int64_t end_us = esp_timer_get_time();
+
+    group->replayed.stages[STAGE_QUEUE] = start_us - group->arrival_us;
+    group->replayed.stages[STAGE_CPU] = host_time_us() - host_start_us;
+    group->replayed.stages[STAGE_TOTAL] = end_us - group->arrival_us;
+    current = NULL;
+}
+
+// }} replay
+
+// {{ report
+
+static void report_csv()
+{
+    printf("index,kind");
+    for (uint8_t s = 0; s < STAGE_MAX; s++) {
+        printf(",rec_%s_us", stage_names[s]);
+    }
+    for (uint8_t s = 0; s < STAGE_MAX; s++) {
+        printf(",%s_us", stage_names[s]);
+    }
+    printf(",rf_recorded,rf_matched,rf_issued,out_recorded,out_matched,out_issued\n");
+
+    for (size_t i = 0; i < group_count; i++) {
+        const group_t *group = &groups[i];
+
+        printf("%zu,%s", group->replayed.index, group->replayed.kind);
+        for (uint8_t s = 0; s < STAGE_MAX; s++) {
+            printf(",%" PRId64, group->recorded.stages[s]);
+        }
+        for (uint8_t s = 0; s < STAGE_MAX; s++) {
+            printf(",%" PRId64, group->replayed.stages[s]);
+        }
+        printf(",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+            group->recorded.rf,
+            group->replayed.rf,
+            group->rf_issued,
+            group->recorded.out,
+            group->replayed.out,
+            group->out_issued);
+    }
+}
+
+/**
+ * Reads replayed timings of the rows of a CSV written by report_csv()
+ *
+ * @return number of rows, rows are indexed by their index column
+ */
+static size_t baseline_load(const char *path, row_t *rows, size_t rows_max)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return 0;
+    }
+
+    char line[REPLAY_LINE_LENGTH];
+    size_t count = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *columns[REPLAY_COLUMNS] = { 0 };
+        size_t column_count = 0;
+
+        for (char *column = strtok(line, ",\r\n"); column != NULL && column_count < REPLAY_COLUMNS;
+             column = strtok(NULL, ",\r\n")) {
+            columns[column_count++] = column;
+        }
+
+        char *index_end = NULL;
+        size_t index = column_count == REPLAY_COLUMNS ? strtoul(columns[0], &index_end, 10) : rows_max;
+
+        if (index >= rows_max || index_end == columns[0]) { // header or foreign row
+            continue;
+        }
+
+        row_t *row = &rows[index];
+        row->index = index;
+        snprintf(row->kind, REPLAY_KIND_LENGTH, "%s", columns[1]);
+        for (uint8_t s = 0; s < STAGE_MAX; s++) {
+            row->stages[s] = strtoll(columns[2 + STAGE_MAX + s], NULL, 10);
+        }
+        row->rf = strtoul(columns[2 + 2 * STAGE_MAX + 1], NULL, 10); // rf_matched
+        row->out = strtoul(columns[2 + 2 * STAGE_MAX + 4], NULL, 10); // out_matched
+        count++;
+    }
+
+    fclose(file);
+
+    return count;
+}
+
+/**
+ * Prints mean of each stage per event kind, for pairs of rows with the same index and kind
+ */
+static void report_diff(const char *a_label, const row_t *a, const char *b_label, const row_t *b, size_t count)
+{
+    char kinds[REPLAY_KINDS_MAX][REPLAY_KIND_LENGTH] = { 0 };
+    int64_t a_sum[REPLAY_KINDS_MAX][STAGE_MAX] = { 0 };
+    int64_t b_sum[REPLAY_KINDS_MAX][STAGE_MAX] = { 0 };
+    uint32_t samples[REPLAY_KINDS_MAX][STAGE_MAX] = { 0 };
+    uint32_t events[REPLAY_KINDS_MAX] = { 0 };
+    uint32_t behavior_diffs = 0;
+    size_t kind_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].kind[0] == 0 || strcmp(a[i].kind, b[i].kind) != 0) {
+            continue;
+        }
+
+        size_t k = 0;
+        while (k < kind_count && strcmp(kinds[k], a[i].kind) != 0) {
+            k++;
+        }
+        if (k == kind_count) {
+            if (kind_count == REPLAY_KINDS_MAX) {
+                continue;
+            }
+            memcpy(kinds[kind_count++], a[i].kind, REPLAY_KIND_LENGTH);
+        }
+
+        events[k]++;
+        for (uint8_t s = 0; s < STAGE_MAX; s++) {
+            if (a[i].stages[s] >= 0 && b[i].stages[s] >= 0) {
+                a_sum[k][s] += a[i].stages[s];
+                b_sum[k][s] += b[i].stages[s];
+                samples[k][s]++;
+            }
+        }
+
+        if (a[i].rf != b[i].rf || a[i].out != b[i].out) {
+            behavior_diffs++;
+        }
+    }
+
+    fprintf(stderr, "%-16s %6s %-6s %12s %12s %12s %8s\n", "kind", "events", "stage", a_label, b_label, "diff_us",
+        "diff_%");
+
+    for (size_t k = 0; k < kind_count; k++) {
+        for (uint8_t s = 0; s < STAGE_MAX; s++) {
+            if (samples[k][s] == 0) {
+                continue;
+            }
+
+            int64_t a_mean = a_sum[k][s] / samples[k][s];
+            int64_t b_mean = b_sum[k][s] / samples[k][s];
+            int64_t diff = b_mean - a_mean;
+
+            fprintf(stderr, "%-16s %6" PRIu32 " %-6s %12" PRId64 " %12" PRId64 " %+12" PRId64, kinds[k], events[k],
+                stage_names[s], a_mean, b_mean, diff);
+            if (a_mean != 0) {
+                fprintf(stderr, " %+7.1f%%\n", 100.0 * diff / a_mean);
+            }
+            else {
+                fprintf(stderr, " %8s\n", "-");
+            }
+        }
+    }
+
+    if (behavior_diffs > 0) {
+        fprintf(stderr, "%" PRIu32 " events matched a different number of rf calls or messages\n", behavior_diffs);
+    }
+}
+
+// }} report
+
+static int usage(const char *argv0)
+{
+    fprintf(stderr,
+        "usage: %s [-v] [--baseline <replay.csv>] <trace.bin>\n"
+        "  replays the trace through this firmware revision, writes per-event timings as CSV to stdout\n"
+        "  -v          log firmware messages (repeat for debug)\n"
+        "  --baseline  compare timings with the CSV of a replay of the same trace by another revision\n",
+        argv0);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = NULL;
+    const char *baseline_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            host_log_level = host_log_level == ESP_LOG_WARN ? ESP_LOG_INFO : ESP_LOG_DEBUG;
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        }
+        else if (argv[i][0] != '-' && trace_path == NULL) {
+            trace_path = argv[i];
+        }
+        else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (trace_path == NULL) {
+        return usage(argv[0]);
+    }
+
+    FILE *file = fopen(trace_path, "rb");
+    if (file == NULL) {
+        perror(trace_path);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *buffer = malloc(size > 0 ? size : 1);
+    assert(buffer != NULL);
+    size_t read_size = fread(buffer, 1, size, file);
+    fclose(file);
+
+    if (!trace_load(buffer, read_size)) {
+        return 1;
+    }
+
+    groups_build();
+    replay_init();
+
+    for (size_t i = 0; i < group_count; i++) {
+        replay_group(&groups[i]);
+    }
+
+    report_csv();
+
+    row_t *a = calloc(group_count > 0 ? group_count : 1, sizeof(row_t));
+    row_t *b = calloc(group_count > 0 ? group_count : 1, sizeof(row_t));
+    assert(a != NULL && b != NULL);
+
+    for (size_t i = 0; i < group_count; i++) {
+        a[i] = groups[i].recorded;
+        b[i] = groups[i].replayed;
+    }
+
+    fprintf(stderr, "%zu records, %zu events\n\n", record_count, group_count);
+
+    if (baseline_path != NULL) {
+        memset(a, 0, group_count * sizeof(row_t));
+        if (baseline_load(baseline_path, a, group_count) == 0) {
+            fprintf(stderr, "baseline has no rows\n");
+            return 1;
+        }
+        report_diff("baseline_us", a, "replay_us", b, group_count);
+    }
+    else {
+        report_diff("recorded_us", a, "replay_us", b, group_count);
+    }
+
+    free(a);
+    free(b);
+    free(groups);
+    free(records);
+    free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,696 @@
+#!/usr/bin/env python3
+
+"""
+Generates the CBOR protocol code of the firmware and the TypeScript types of the web from schema.json
+
+  generate.py c <output_dir>   msg_schema.h and msg_schema.c (generated at firmware build time)
+  generate.py ts <output_file> Protocol.ts (committed to the web)
+"""
+
+import argparse
+import json
+import os
+import sys
+
+SCHEMA_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'schema.json')
+BANNER = 'Generated by protocol/generate.py from protocol/schema.json, do not edit'
+
+# schema type: (C type, C limit, CBOR encode function, max encoded size)
+INT_TYPES = {
+    'uint8': ('uint8_t', 'UINT8_MAX', 'cbor_encode_uint', 2),
+    'uint16': ('uint16_t', 'UINT16_MAX', 'cbor_encode_uint', 3),
+    'uint32': ('uint32_t', 'UINT32_MAX', 'cbor_encode_uint', 5),
+    'uint64': ('uint64_t', 'UINT64_MAX', 'cbor_encode_uint', 9),
+    'int32': ('int32_t', None, 'cbor_encode_int', 5),
+    'int64': ('int64_t', None, 'cbor_encode_int', 9),
+}
+
+CTX_KINDS = ('none', 'optional', 'required')
+
+# single byte map header is patched with the number of present optional fields
+MAP_LENGTH_MAX = 23
+
+
+class SchemaError(Exception):
+    pass
+
+
+# {{ schema
+
+class Field:
+    # owner is the prefix of the bound macros, e.g. MSG_PICC for field of the picc type
+    def __init__(self, owner, spec, types):
+        self.name = spec['name']
+        self.ident = self.name.lstrip('$')
+        self.type = spec['type']
+        self.optional = spec.get('optional', False)
+        self.nullable = spec.get('nullable', False)
+        self.length = spec.get('length')
+        self.length_max = spec.get('length_max')
+        self.count_max = spec.get('count_max')
+        self.items = spec.get('items')
+        self.c_type = spec.get('c_type')
+        self.doc = spec.get('doc')
+        self.bound_macro = f'{owner}_{self.ident}'.upper()
+
+        where = f'{owner}.{self.name}'
+
+        if self.type in ('bytes', 'text'):
+            if (self.length is None) == (self.length_max is None):
+                raise SchemaError(f'{where}: exactly one of length and length_max is required')
+            if self.type == 'text' and self.length is not None:
+                raise SchemaError(f'{where}: text supports length_max only')
+        elif self.type == 'array':
+            if self.items not in types or self.count_max is None:
+                raise SchemaError(f'{where}: array requires items of known type and count_max')
+        elif self.type not in INT_TYPES and self.type not in types:
+            raise SchemaError(f'{where}: unknown type {self.type}')
+
+        if (self.optional or self.nullable) and self.type in INT_TYPES:
+            raise SchemaError(f'{where}: integers cannot be optional or nullable')
+
+    @property
+    def is_struct(self):
+        return self.type not in INT_TYPES and self.type not in ('bytes', 'text', 'array')
+
+    @property
+    def key(self):
+        return text_bytes(self.name)
+
+
+class Device:
+    def __init__(self, kind, spec, types):
+        self.kind = kind
+        self.ctx = spec.get('ctx', 'none')
+        self.doc = spec.get('doc')
+        self.fields = [Field(f'enc_{kind}', field, types) for field in spec['fields']]
+
+        if self.ctx not in CTX_KINDS:
+            raise SchemaError(f'{kind}: ctx must be one of {CTX_KINDS}')
+
+        if 1 + (self.ctx != 'none') + len(self.fields) > MAP_LENGTH_MAX:
+            raise SchemaError(f'{kind}: too many fields')
+
+    @property
+    def required_fields(self):
+        return [field for field in self.fields if not field.optional]
+
+
+class Schema:
+    def __init__(self, spec):
+        self.id_length_max = spec['id']['length_max']
+        self.id_doc = spec['id'].get('doc')
+        self.c_includes = spec.get('c_includes', [])
+        self.types = {}
+        for name, fields in spec['types'].items():
+            self.types[name] = [Field(f'msg_{name}', field, spec['types']) for field in fields]
+        self.web = {}
+        for kind, fields in spec['web'].items():
+            self.web[kind] = [Field(f'dec_{kind}', field, self.types) for field in fields]
+        self.device = {kind: Device(kind, device, self.types) for kind, device in spec['device'].items()}
+
+    def types_used_by(self, fields_list):
+        used = []
+
+        def visit(fields):
+            for field in fields:
+                name = field.items if field.type == 'array' else field.type
+                if name in self.types and name not in used:
+                    visit(self.types[name])
+                    used.append(name)
+
+        for fields in fields_list:
+            visit(fields)
+
+        return used
+
+    @property
+    def decoded_types(self):
+        return self.types_used_by(self.web.values())
+
+    @property
+    def encoded_types(self):
+        return self.types_used_by(device.fields for device in self.device.values())
+
+
+def load_schema(path=SCHEMA_PATH):
+    with open(path) as file:
+        return Schema(json.load(file))
+
+# }} schema
+
+# {{ cbor
+
+
+def head_bytes(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, size in ((24, 1), (25, 2), (26, 4), (27, 8)):
+        if value < 1 << (8 * size):
+            return bytes([major << 5 | info]) + value.to_bytes(size, 'big')
+    raise ValueError(value)
+
+
+def text_bytes(text):
+    return head_bytes(3, len(text)) + text.encode()
+
+
+def head_size(value):
+    return len(head_bytes(0, value))
+
+
+def value_size_max(schema, field):
+    if field.type in INT_TYPES:
+        return INT_TYPES[field.type][3]
+    if field.type in ('bytes', 'text'):
+        length = field.length if field.length is not None else field.length_max
+        return head_size(length) + length
+    if field.type == 'array':
+        return head_size(field.count_max) + field.count_max * map_size_max(schema, schema.types[field.items])
+    return map_size_max(schema, schema.types[field.type])
+
+
+def map_size_max(schema, fields):
+    return head_size(len(fields)) + sum(len(field.key) + value_size_max(schema, field) for field in fields)
+
+
+def ctx_suffix_bytes():
+    return text_bytes('$ctx') + head_bytes(5, 1) + text_bytes('$id')
+
+
+def prefix_bytes(device, with_ctx):
+    length = 1 + with_ctx + len(device.required_fields)
+    prefix = head_bytes(5, length) + text_bytes('$kind') + text_bytes(device.kind)
+    if with_ctx:
+        prefix += ctx_suffix_bytes()
+    return prefix
+
+
+def device_size_max(schema, device):
+    size = len(prefix_bytes(device, device.ctx != 'none'))
+    if device.ctx != 'none':
+        size += head_size(schema.id_length_max) + schema.id_length_max
+    return size + sum(len(field.key) + value_size_max(schema, field) for field in device.fields)
+
+# }} cbor
+
+# {{ c
+
+
+def c_bytes(data, indent):
+    lines = []
+    for i in range(0, len(data), 12):
+        lines.append(indent + ', '.join(f'0x{byte:02x}' for byte in data[i:i + 12]) + ',')
+    return '\n'.join(lines)
+
+
+def c_comment(doc, indent=''):
+    return f'{indent}// {doc}\n' if doc else ''
+
+
+def c_field_bounds(field):
+    if field.length is not None:
+        return [(f'{field.bound_macro}_LENGTH', field.length)]
+    if field.length_max is not None:
+        return [(f'{field.bound_macro}_LENGTH_MAX', field.length_max)]
+    if field.count_max is not None:
+        return [(f'{field.bound_macro}_COUNT_MAX', field.count_max)]
+    return []
+
+
+def c_decoded_member(field):
+    if field.type in INT_TYPES:
+        return f'{field.c_type or INT_TYPES[field.type][0]} {field.ident};'
+    if field.type == 'bytes' and field.length is not None:
+        return f'uint8_t {field.ident}[{field.bound_macro}_LENGTH];'
+    if field.is_struct:
+        return f'msg_{field.type}_t {field.ident};'
+    raise SchemaError(f'{field.name}: decoding of {field.type} is not supported')
+
+
+def c_encoded_params(field):
+    if field.type in INT_TYPES:
+        return [f'{INT_TYPES[field.type][0]} {field.ident}']
+    if field.type == 'bytes':
+        params = [f'const uint8_t *{field.ident}']
+        if field.length is None:
+            params.append(f'size_t {field.ident}_length')
+        return params
+    if field.type == 'text':
+        return [f'const char *{field.ident}']
+    if field.type == 'array':
+        return [f'const enc_{field.items}_t *{field.ident}', f'size_t {field.ident}_count']
+    return [f'const enc_{field.type}_t *{field.ident}']
+
+
+def c_encoded_members(field):
+    return [param + ';' for param in c_encoded_params(field)]
+
+
+def c_web_struct_name(kind):
+    return f'web_{kind}_msg_t'
+
+
+def c_signature(device):
+    params = ['enc_frame_t *frame']
+    if device.ctx != 'none':
+        params.append('const web_msg_t *ctx')
+    for field in device.fields:
+        params.extend(c_encoded_params(field))
+    return f'CborError msg_enc_{device.kind}({", ".join(params)})'
+
+
+def c_wrap_signature(signature):
+    if len(signature) + 1 <= 120:
+        return signature + ';'
+    name, params = signature.split('(', 1)
+    params = params[:-1].split(', ')
+    return name + '(' + params[0] + ',\n' + ',\n'.join('    ' + param for param in params[1:]) + ');'
+
+
+def generate_c_header(schema):
+    out = []
+    out.append(f'// {BANNER}\n\n')
+    out.append('#pragma once\n\n')
+    out.append('#include <inttypes.h>\n#include <stdbool.h>\n#include <stddef.h>\n#include "cbor.h"\n')
+    for include in schema.c_includes:
+        out.append(f'#include "{include}"\n')
+    out.append('\n// Included by msg.h, which provides enc_frame_t\n')
+
+    out.append('\n// {{ kinds\n\n')
+    width = max(len(kind) for kind in schema.device) + len('ENC__MSG_KIND')
+    for kind in schema.device:
+        out.append(f'#define {f"ENC_{kind.upper()}_MSG_KIND":<{width}} "{kind}"\n')
+    out.append('\ntypedef enum\n{\n    WEB_MSG_UNKNOWN = -1,\n    WEB_MSG_UNDEFINED = 0,\n')
+    for kind in schema.web:
+        out.append(f'    WEB_MSG_{kind.upper()},\n')
+    out.append('} web_msg_kind_t;\n\n')
+    out.append(f'#define MSG_KIND_LENGTH_MAX {max(len(kind) for kind in schema.web)}\n')
+    id_doc = f' // {schema.id_doc}' if schema.id_doc else ''
+    out.append(f'#define MSG_ID_LENGTH_MAX   {schema.id_length_max}{id_doc}\n\n')
+    out.append('typedef struct\n{\n    char id[MSG_ID_LENGTH_MAX + 1];\n    web_msg_kind_t kind;\n} web_msg_t;\n')
+    out.append('\n// }} kinds\n')
+
+    out.append('\n// {{ bounds\n\n')
+    bounds = []
+    for name, fields in schema.types.items():
+        bounds.extend(bound for field in fields for bound in c_field_bounds(field))
+    for fields in schema.web.values():
+        bounds.extend(bound for field in fields for bound in c_field_bounds(field))
+    for device in schema.device.values():
+        bounds.extend(bound for field in device.fields for bound in c_field_bounds(field))
+    sizes = []
+    for kind, device in schema.device.items():
+        sizes.append((f'ENC_{kind.upper()}_SIZE_MAX', device_size_max(schema, device)))
+    sizes.append(('ENC_SIZE_MAX', max(size for _, size in sizes)))
+    width = max(len(name) for name, _ in bounds + sizes) + 1
+    for name, value in bounds:
+        out.append(f'#define {name:<{width}}{value}\n')
+    out.append('\n// encoded size of the message with all optional fields and variable fields of maximal length\n')
+    for name, value in sizes:
+        out.append(f'#define {name:<{width}}({value})\n')
+    out.append('\n// }} bounds\n')
+
+    out.append('\n// {{ decoding\n')
+    for name in schema.decoded_types:
+        out.append('\ntypedef struct\n{\n')
+        for field in schema.types[name]:
+            out.append(c_comment(field.doc, '    '))
+            out.append(f'    {c_decoded_member(field)}\n')
+        out.append(f'}} msg_{name}_t;\n')
+    for kind, fields in schema.web.items():
+        if not fields:
+            continue
+        out.append('\ntypedef struct\n{\n')
+        for field in fields:
+            out.append(c_comment(field.doc, '    '))
+            if field.optional:
+                out.append(f'    bool has_{field.ident};\n')
+            out.append(f'    {c_decoded_member(field)}\n')
+        out.append(f'}} {c_web_struct_name(kind)};\n')
+    out.append('\nweb_msg_kind_t msg_dec_kind(const char *kind_str);\n')
+    for kind, fields in schema.web.items():
+        if fields:
+            out.append(f'\nCborError msg_dec_{kind}(const uint8_t *buffer, size_t buffer_size, '
+                       f'{c_web_struct_name(kind)} *out_msg);\n')
+    out.append('\n// }} decoding\n')
+
+    out.append('\n// {{ encoding\n')
+    for name in schema.encoded_types:
+        out.append('\ntypedef struct\n{\n')
+        for field in schema.types[name]:
+            out.append(c_comment(field.doc, '    '))
+            for member in c_encoded_members(field):
+                out.append(f'    {member}\n')
+        out.append(f'}} enc_{name}_t;\n')
+    for device in schema.device.values():
+        out.append('\n')
+        if device.doc:
+            out.append(f'/**\n * {device.doc}\n */\n')
+        out.append(c_wrap_signature(c_signature(device)) + '\n')
+    out.append('\n// }} encoding\n')
+
+    return ''.join(out)
+
+
+class CWriter:
+    def __init__(self):
+        self.lines = []
+        self.depth = 0
+
+    def line(self, text=''):
+        self.lines.append(('    ' * self.depth + text) if text else '')
+
+    def open(self, text):
+        self.line(text + ' {')
+        self.depth += 1
+
+    def function(self, signature):
+        self.lines.extend(signature.split('\n'))
+        self.line('{')
+        self.depth += 1
+
+    def close(self, text='}'):
+        self.depth -= 1
+        self.line(text)
+
+    def text(self):
+        return '\n'.join(self.lines) + '\n'
+
+
+def c_encode_key(w, encoder, field):
+    w.line(f'CBOR_ERRCHECK(cbor_encode_text_string({encoder}, "{field.name}", {len(field.name)}));')
+
+
+def c_encode_value(w, encoder, field, ref):
+    if field.type in INT_TYPES:
+        w.line(f'CBOR_ERRCHECK({INT_TYPES[field.type][2]}({encoder}, {ref}));')
+        return
+
+    if field.nullable:
+        w.open(f'if ({ref} == NULL)')
+        w.line(f'CBOR_ERRCHECK(cbor_encode_null({encoder}));')
+        w.close()
+        w.open('else')
+
+    if field.type == 'bytes' and field.length is not None:
+        w.line(f'CBOR_ERRCHECK(cbor_encode_byte_string({encoder}, {ref}, {field.bound_macro}_LENGTH));')
+    elif field.type == 'bytes':
+        w.line(f'CBOR_RETCHECK({ref}_length <= {field.bound_macro}_LENGTH_MAX, CborErrorDataTooLarge);')
+        w.line(f'CBOR_ERRCHECK(cbor_encode_byte_string({encoder}, {ref}, {ref}_length));')
+    elif field.type == 'text':
+        w.line(f'size_t {field.ident}_length = strlen({ref});')
+        w.line(f'CBOR_RETCHECK({field.ident}_length <= {field.bound_macro}_LENGTH_MAX, CborErrorDataTooLarge);')
+        w.line(f'CBOR_ERRCHECK(cbor_encode_text_string({encoder}, {ref}, {field.ident}_length));')
+    elif field.type == 'array':
+        array = f'{field.ident}_array'
+        w.line(f'CBOR_RETCHECK({ref}_count <= {field.bound_macro}_COUNT_MAX, CborErrorDataTooLarge);')
+        w.line(f'CborEncoder {array};')
+        w.line(f'CBOR_ERRCHECK(cbor_encoder_create_array({encoder}, &{array}, {ref}_count));')
+        w.open(f'for (size_t i = 0; i < {ref}_count; i++)')
+        w.line(f'CBOR_ERRCHECK(enc_{field.items}(&{array}, &{ref}[i]));')
+        w.close()
+        w.line(f'CBOR_ERRCHECK(cbor_encoder_close_container({encoder}, &{array}));')
+    else:
+        w.line(f'CBOR_ERRCHECK(enc_{field.type}({encoder}, {ref}));')
+
+    if field.nullable:
+        w.close()
+
+
+def c_encode_field(w, encoder, field, ref):
+    if field.optional:
+        w.open(f'if ({ref} != NULL)')
+    c_encode_key(w, encoder, field)
+    c_encode_value(w, encoder, field, ref)
+    if field.optional:
+        w.close()
+
+
+def c_optional_count(fields, ref_prefix):
+    optional = [f'({ref_prefix}{field.ident} != NULL)' for field in fields if field.optional]
+    return ' + '.join(optional)
+
+
+def generate_c_type_encoder(w, schema, name):
+    fields = schema.types[name]
+    required = len([field for field in fields if not field.optional])
+    optional_count = c_optional_count(fields, 'value->')
+    length = f'{required} + {optional_count}' if optional_count else f'{required}'
+
+    w.function(f'static CborError enc_{name}(CborEncoder *encoder, const enc_{name}_t *value)')
+    w.line('CborEncoder map;')
+    w.line()
+    w.line(f'CBOR_ERRCHECK(cbor_encoder_create_map(encoder, &map, {length}));')
+    for field in fields:
+        c_encode_field(w, '&map', field, f'value->{field.ident}')
+    w.line('CBOR_ERRCHECK(cbor_encoder_close_container(encoder, &map));')
+    w.line()
+    w.line('return CborNoError;')
+    w.close()
+    w.line()
+
+
+def generate_c_device_encoder(w, schema, device):
+    optional_count = c_optional_count(device.fields, '')
+
+    def begin(prefix):
+        count = 'optional_count' if optional_count else '0'
+        args = f'frame, {prefix}, sizeof({prefix}), {count}, &encoder'
+        if len('    ' * w.depth + f'CBOR_ERRCHECK(enc_frame_begin({args}));') <= 120:
+            w.line(f'CBOR_ERRCHECK(enc_frame_begin({args}));')
+        else:
+            w.line('CBOR_ERRCHECK(enc_frame_begin(')
+            w.line(f'    {args}));')
+
+    w.function(c_wrap_signature(c_signature(device))[:-1])
+    w.line('CborEncoder encoder;')
+    if optional_count:
+        w.line(f'uint8_t optional_count = {optional_count};')
+    w.line()
+    if device.ctx == 'required':
+        w.line('CBOR_RETCHECK(ctx != NULL, CborErrorImproperValue);')
+    if device.ctx == 'optional':
+        w.open('if (ctx != NULL)')
+    if device.ctx != 'none':
+        begin(f'{device.kind}_ctx_prefix')
+        w.line('CBOR_ERRCHECK(cbor_encode_text_stringz(&encoder, ctx->id));')
+    if device.ctx == 'optional':
+        w.close()
+        w.open('else')
+    if device.ctx != 'required':
+        begin(f'{device.kind}_prefix')
+    if device.ctx == 'optional':
+        w.close()
+    for field in device.fields:
+        c_encode_field(w, '&encoder', field, field.ident)
+    w.line()
+    w.line('return enc_frame_end(frame, &encoder);')
+    w.close()
+    w.line()
+
+
+def c_decode_field(w, field, ref):
+    if field.type in INT_TYPES:
+        c_type, limit, _, _ = INT_TYPES[field.type]
+        if limit is None:
+            raise SchemaError(f'{field.name}: decoding of {field.type} is not supported')
+        w.line(f'CBOR_ERRCHECK(dec_uint(&field, {limit}, &uint_value));')
+        w.line(f'{ref} = ({field.c_type or c_type})uint_value;')
+    elif field.type == 'bytes' and field.length is not None:
+        w.line(f'CBOR_ERRCHECK(dec_byte_string(&field, {ref}, {field.bound_macro}_LENGTH));')
+    elif field.is_struct:
+        w.line('CBOR_RETCHECK(cbor_value_is_map(&field), CborErrorIllegalType);')
+        w.line(f'CBOR_ERRCHECK(dec_{field.type}(&field, &{ref}));')
+    else:
+        raise SchemaError(f'{field.name}: decoding of {field.type} is not supported')
+
+
+def c_decode_fields(w, fields, map_ref, value_prefix):
+    w.line('CborValue field;')
+    if any(field.type in INT_TYPES for field in fields):
+        w.line('uint64_t uint_value = 0;')
+    for field in fields:
+        w.line(f'CBOR_ERRCHECK(cbor_value_map_find_value({map_ref}, "{field.name}", &field));')
+        if field.optional:
+            w.open('if (dec_is_present(&field))')
+        c_decode_field(w, field, f'{value_prefix}{field.ident}')
+        if field.optional:
+            w.line(f'{value_prefix}has_{field.ident} = true;')
+            w.close()
+
+
+def generate_c_type_decoder(w, schema, name):
+    w.function(f'static CborError dec_{name}(const CborValue *map, msg_{name}_t *out_value)')
+    w.line(f'msg_{name}_t value = {{ 0 }};')
+    w.line()
+    c_decode_fields(w, schema.types[name], 'map', 'value.')
+    w.line()
+    w.line('memcpy(out_value, &value, sizeof(value));')
+    w.line('return CborNoError;')
+    w.close()
+    w.line()
+
+
+def generate_c_web_decoder(w, kind, fields):
+    struct = c_web_struct_name(kind)
+    w.function(f'CborError msg_dec_{kind}(const uint8_t *buffer, size_t buffer_size, {struct} *out_msg)')
+    w.line(f'{struct} msg = {{ 0 }};')
+    w.line()
+    w.line('CborParser parser;')
+    w.line('CborValue it;')
+    w.line('CBOR_ERRCHECK(cbor_parser_init(buffer, buffer_size, 0, &parser, &it));')
+    c_decode_fields(w, fields, '&it', 'msg.')
+    w.line()
+    w.line('memcpy(out_msg, &msg, sizeof(msg));')
+    w.line('return CborNoError;')
+    w.close()
+    w.line()
+
+
+def generate_c_source(schema):
+    w = CWriter()
+    w.line(f'// {BANNER}')
+    w.line()
+    w.line('#include <string.h>')
+    w.line('#include "msg.h"')
+    w.line()
+
+    w.line('// {{ decoding')
+    w.line()
+    w.line('static const struct')
+    w.line('{')
+    w.line('    const char *kind_str;')
+    w.line('    web_msg_kind_t kind;')
+    w.line('} web_msg_kind_map[] = {')
+    for kind in schema.web:
+        w.line(f'    {{ "{kind}", WEB_MSG_{kind.upper()} }},')
+    w.line('};')
+    w.line()
+    w.function('web_msg_kind_t msg_dec_kind(const char *kind_str)')
+    w.open('for (size_t i = 0; i < sizeof(web_msg_kind_map) / sizeof(web_msg_kind_map[0]); i++)')
+    w.open('if (strcmp(kind_str, web_msg_kind_map[i].kind_str) == 0)')
+    w.line('return web_msg_kind_map[i].kind;')
+    w.close()
+    w.close()
+    w.line()
+    w.line('return WEB_MSG_UNKNOWN;')
+    w.close()
+    w.line()
+    for name in schema.decoded_types:
+        generate_c_type_decoder(w, schema, name)
+    for kind, fields in schema.web.items():
+        if fields:
+            generate_c_web_decoder(w, kind, fields)
+    w.line('// }} decoding')
+    w.line()
+
+    w.line('// {{ encoding')
+    w.line()
+    w.line('// pre-encoded map header, $kind and the key of $id in $ctx, copied to the frame with a single memcpy')
+    w.line()
+    for device in schema.device.values():
+        variants = []
+        if device.ctx != 'required':
+            variants.append((f'{device.kind}_prefix', False))
+        if device.ctx != 'none':
+            variants.append((f'{device.kind}_ctx_prefix', True))
+        for name, with_ctx in variants:
+            length = 1 + with_ctx + len(device.required_fields)
+            ctx = ', "$ctx": map(1) "$id":' if with_ctx else ''
+            w.line(f'// map({length}) "$kind": "{device.kind}"{ctx}')
+            w.line(f'static const uint8_t {name}[] = {{')
+            w.lines.append(c_bytes(prefix_bytes(device, with_ctx), '    '))
+            w.line('};')
+            w.line()
+    for name in schema.encoded_types:
+        generate_c_type_encoder(w, schema, name)
+    for device in schema.device.values():
+        generate_c_device_encoder(w, schema, device)
+    w.line('// }} encoding')
+
+    return w.text()
+
+# }} c
+
+# {{ ts
+
+
+def ts_pascal(name):
+    return ''.join(part.capitalize() for part in name.split('_'))
+
+
+def ts_type(field):
+    if field.type == 'uint64':
+        result = 'number | bigint'  # decoded as bigint beyond the safe integer range
+    elif field.type in INT_TYPES:
+        result = 'number'
+    elif field.type == 'bytes':
+        result = 'Uint8Array'
+    elif field.type == 'text':
+        result = 'string'
+    elif field.type == 'array':
+        result = f'{ts_pascal(field.items)}Fields[]'
+    else:
+        result = f'{ts_pascal(field.type)}Fields'
+    return f'{result} | null' if field.nullable else result
+
+
+def ts_doc(doc, indent=''):
+    return f'{indent}/**\n{indent} * {doc}\n{indent} */\n' if doc else ''
+
+
+def ts_interface(name, fields, doc=None):
+    if not fields:
+        return f'{ts_doc(doc)}export interface {name} {{ }}\n'
+    out = [ts_doc(doc), f'export interface {name} {{\n']
+    for field in fields:
+        out.append(ts_doc(field.doc, '  '))
+        out.append(f'  readonly {field.name}{"?" if field.optional else ""}: {ts_type(field)};\n')
+    out.append('}\n')
+    return ''.join(out)
+
+
+def generate_ts(schema):
+    out = [f'// {BANNER}\n\n']
+    out.append('export type WebMessageKind =\n' + '\n'.join(f"  | '{kind}'" for kind in schema.web) + ';\n\n')
+    out.append('export type DeviceMessageKind =\n' + '\n'.join(f"  | '{kind}'" for kind in schema.device) + ';\n')
+    for name, fields in schema.types.items():
+        out.append('\n' + ts_interface(f'{ts_pascal(name)}Fields', fields))
+    for kind, fields in schema.web.items():
+        out.append('\n' + ts_interface(f'{ts_pascal(kind)}WebMessageFields', fields))
+    for kind, device in schema.device.items():
+        out.append('\n' + ts_interface(f'{ts_pascal(kind)}DeviceMessageFields', device.fields, device.doc))
+    return ''.join(out)
+
+# }} ts
+
+
+def write(path, content):
+    with open(path, 'w') as file:
+        file.write(content)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('target', choices=('c', 'ts'))
+    parser.add_argument('output', help='output directory (c) or file (ts)')
+    args = parser.parse_args()
+
+    try:
+        schema = load_schema()
+        if args.target == 'c':
+            os.makedirs(args.output, exist_ok=True)
+            write(os.path.join(args.output, 'msg_schema.h'), generate_c_header(schema))
+            write(os.path.join(args.output, 'msg_schema.c'), generate_c_source(schema))
+        else:
+            write(args.output, generate_ts(schema))
+    except SchemaError as e:
+        print(f'{SCHEMA_PATH}: {e}', file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -2,6 +2,7 @@ import clientEmits from "@/communication/clientEmits";
 import ClientCloseEvent from "@/communication/events/ClientCloseEvent";
 import ClientDisconnectEvent from "@/communication/events/ClientDisconnectEvent";
 import ClientEndEvent from "@/communication/events/ClientEndEvent";
+import ClientLatencyEvent from "@/communication/events/ClientLatencyEvent";
 import ClientMessageEvent from "@/communication/events/ClientMessageEvent";
 import ClientOfflineEvent from "@/communication/events/ClientOfflineEvent";
 import ClientPingEvent from "@/communication/events/ClientPingEvent";
@@ -9,8 +10,13 @@ import ClientPongEvent from "@/communication/events/ClientPongEvent";
 import ClientPongMissedEvent from "@/communication/events/ClientPongMissedEvent";
 import ClientReadyEvent from "@/communication/events/ClientReadyEvent";
 import ClientReconnectEvent from "@/communication/events/ClientReconnectEvent";
+import ClientTransportEvent from "@/communication/events/ClientTransportEvent";
+import LanTransport from "@/communication/LanTransport";
+import LatencyStats from "@/communication/LatencyStats";
 import { DeviceMessage, WebMessage } from "@/communication/Message";
+import HelloDeviceMessage, { isHelloDeviceMessage } from "@/communication/messages/device/HelloDeviceMessage";
 import PongDeviceMessage, { isPongDeviceMessage } from "@/communication/messages/device/PongDeviceMessage";
+import HelloWebMessage from "@/communication/messages/web/HelloWebMessage";
 import PingWebMessage from "@/communication/messages/web/PingWebMessage";
 import { CancelationToken, OperationCanceledError } from "@/utils/CancelationToken";
 import { randomHex, strmask, trim } from "@/utils/helpers";
@@ -36,6 +42,8 @@ class SendContext {
   constructor(readonly message: WebMessage) { }
 }
 
+export type ClientTransportKind = 'broker' | 'lan';
+
 class Client {
   private readonly logger = logger('Client');
   static readonly DefaultBrokerUrl = "wss://broker.emqx.io:8084/mqtt";
@@ -44,8 +52,11 @@ class Client {
   readonly devTopic: string;
   readonly webTopic: string;
   private mqttClient: MqttClient | null = null;
+  private lanTransport: LanTransport | null = null;
+  readonly latency = new LatencyStats();
   private readonly sendTimeoutMs;
   private readonly receiveTimeoutMs;
+  private readonly lanConnectTimeoutMs;
 
   get rootTopicMasked(): string {
     return strmask(this.rootTopic, { side: 'right', offset: 2, ratio: .65 });
@@ -61,10 +72,18 @@ class Client {
     this.devTopic = 'dev';
     this.sendTimeoutMs = 2000;
     this.receiveTimeoutMs = 3000;
+    this.lanConnectTimeoutMs = 1500;
   }
 
   get connected(): boolean {
-    return this.mqttClient?.connected === true;
+    return this.mqttClient?.connected === true || this.lanTransport?.open === true;
+  }
+
+  /**
+   * Messages are sent over the lan endpoint of the device while it is reachable, over the broker otherwise.
+   */
+  get transport(): ClientTransportKind {
+    return this.lanTransport?.open === true ? 'lan' : 'broker';
   }
 
   get devTopicAbs(): string {
@@ -76,8 +95,17 @@ class Client {
   }
 
   async transceive(message: WebMessage, cancelationToken?: CancelationToken): Promise<DeviceMessage> {
+    const via = this.transport;
+    const sentAt = performance.now();
     const ctx = await this.send(message, cancelationToken);
-    return this.receive(ctx, cancelationToken);
+    const reply = await this.receive(ctx, cancelationToken);
+
+    if (reply.$timing !== undefined) {
+      const sample = this.latency.add(message.$kind, via, sentAt, performance.now(), reply.$timing);
+      clientEmits.emit('latency', new ClientLatencyEvent(this, sample, this.latency.summary()));
+    }
+
+    return reply;
   }
 
   async send(message: WebMessage, cancelationToken?: CancelationToken): Promise<SendContext> {
@@ -85,9 +113,17 @@ class Client {
       throw new Error('not connected');
     }
 
+    const encodedMessage = encode(message);
+
+    if (this.lanTransport?.open === true) {
+      cancelationToken?.throwIfCanceled();
+      this.lanTransport.send(encodedMessage);
+      this.logSentMessage('lan', message, encodedMessage);
+      return new SendContext(message);
+    }
+
     return new Promise((resolve, reject) => {
       const topic = `/${this.webTopicAbs}`;
-      const encodedMessage = encode(message);
 
       const _timeout = setTimeout(() => {
         reject(new MessageSendTimeoutError());
@@ -113,10 +149,7 @@ class Client {
           return;
         }
 
-        const logLevel = message instanceof PingWebMessage ? LogLevel.VERBOSE : LogLevel.DEBUG;
-
-        this.logger.log(logLevel, 'message sent', topic, message);
-        this.logger.verbose('encoded sent message:', encodedMessage);
+        this.logSentMessage(topic, message, encodedMessage);
 
         resolve(new SendContext(message));
       };
@@ -125,6 +158,80 @@ class Client {
     });
   }
 
+  private logSentMessage(destination: string, message: WebMessage, encodedMessage: Uint8Array) {
+    const logLevel = message instanceof PingWebMessage ? LogLevel.VERBOSE : LogLevel.DEBUG;
+
+    this.logger.log(logLevel, 'message sent', destination, message);
+    this.logger.verbose('encoded sent message:', encodedMessage);
+  }
+
+  private onEncodedMessage(transport: ClientTransportKind, source: string, encodedMessage: Uint8Array) {
+    const decodedMessage = decode(encodedMessage) as DeviceMessage;
+
+    // device sends unsolicited messages with all its transports, replies only with the one of the request
+    if (transport === 'broker' && this.transport === 'lan' && decodedMessage.$ctx === undefined) {
+      return;
+    }
+
+    let logLevel = LogLevel.DEBUG;
+
+    if (isPongDeviceMessage(decodedMessage)) {
+      logLevel = LogLevel.VERBOSE;
+    }
+
+    this.logger.log(logLevel, 'message received', source, decodedMessage);
+    this.logger.verbose('encoded received message:', encodedMessage);
+
+    if (isHelloDeviceMessage(decodedMessage)) {
+      this.connectLan(decodedMessage);
+    }
+
+    clientEmits.emit('message', new ClientMessageEvent(this, decodedMessage));
+  }
+
+  /**
+   * Switches to the lan endpoint advertised by the device, if it is reachable.
+   */
+  private async connectLan(hello: HelloDeviceMessage) {
+    if (!hello.lan || this.lanTransport?.url.toString() === new URL(hello.lan).toString()) {
+      return;
+    }
+
+    if (window.location.protocol === 'https:') {
+      this.logger.debug('lan endpoint skipped: ws:// is blocked on https pages', hello.lan);
+      return;
+    }
+
+    this.lanTransport?.close();
+
+    const lanTransport = new LanTransport(
+      new URL(hello.lan),
+      this.rootTopic,
+      encodedMessage => this.onEncodedMessage('lan', hello.lan!, encodedMessage),
+      () => {
+        if (this.lanTransport === lanTransport) {
+          this.lanTransport = null;
+          this.logger.debug('lan endpoint closed, falling back to broker');
+          clientEmits.emit('transport', new ClientTransportEvent(this, this.transport));
+        }
+      },
+    );
+
+    this.lanTransport = lanTransport;
+
+    try {
+      await lanTransport.connect(this.lanConnectTimeoutMs);
+      this.logger.debug('switched to lan endpoint', hello.lan);
+      clientEmits.emit('transport', new ClientTransportEvent(this, this.transport));
+    } catch (e) {
+      this.logger.debug('lan endpoint is not reachable, staying on broker', hello.lan, e);
+      if (this.lanTransport === lanTransport) {
+        this.lanTransport = null;
+        clientEmits.emit('transport', new ClientTransportEvent(this, this.transport));
+      }
+    }
+  }
+
   private async receive(ctx: SendContext, cancelationToken?: CancelationToken): Promise<DeviceMessage> {
     if (!this.connected) {
       throw new Error('not connected');
@@ -188,22 +295,14 @@ class Client {
 
         this.logger.debug('subscribed to', topic);
         clientEmits.emit('ready', new ClientReadyEvent(this));
+
+        // response advertises the lan endpoint, if the device serves one
+        this.send(new HelloWebMessage()).catch(e => this.logger.debug('hello failed', e));
       });
     });
 
     this.mqttClient.on('message', (topic, encodedMessage) => {
-      const decodedMessage = decode(encodedMessage) as DeviceMessage;
-
-      let logLevel = LogLevel.DEBUG;
-
-      if (isPongDeviceMessage(decodedMessage)) {
-        logLevel = LogLevel.VERBOSE;
-      }
-
-      this.logger.log(logLevel, 'message received', topic, decodedMessage);
-      this.logger.verbose('encoded received message:', encodedMessage);
-
-      clientEmits.emit('message', new ClientMessageEvent(this, decodedMessage));
+      this.onEncodedMessage('broker', topic, encodedMessage);
     });
 
     this.mqttClient.on('reconnect', () => {
@@ -239,6 +338,10 @@ class Client {
       throw new Error('not connected');
     }
 
+    const lanTransport = this.lanTransport;
+    this.lanTransport = null;
+    lanTransport?.close();
+
     this.mqttClient.end(true);
   }
 
@@ -0,0 +1,82 @@
+import logger from "@/utils/Logger";
+
+/**
+ * Websocket connection to the endpoint served by the device on the local network,
+ * which carries the same messages as the broker without leaving the network.
+ * Device accepts only clients which pass its root topic as the token of the handshake.
+ */
+class LanTransport {
+  private readonly logger = logger('LanTransport');
+  private socket: WebSocket | null = null;
+
+  constructor(
+    readonly url: URL,
+    private readonly token: string,
+    private readonly onMessage: (encodedMessage: Uint8Array) => void,
+    private readonly onClose: () => void,
+  ) { }
+
+  get open(): boolean {
+    return this.socket?.readyState === WebSocket.OPEN;
+  }
+
+  /**
+   * Resolves when the connection is open, rejects if the endpoint is not reachable within @p timeoutMs.
+   */
+  connect(timeoutMs: number): Promise<void> {
+    return new Promise((resolve, reject) => {
+      const handshakeUrl = new URL(this.url);
+      handshakeUrl.searchParams.set('token', this.token);
+
+      const socket = new WebSocket(handshakeUrl);
+      socket.binaryType = 'arraybuffer';
+
+      const _timeout = setTimeout(() => {
+        socket.close();
+        reject(new Error('lan endpoint is not reachable'));
+      }, timeoutMs);
+
+      socket.onopen = () => {
+        clearTimeout(_timeout);
+        this.logger.debug('open', this.url.toString());
+        this.socket = socket;
+        resolve();
+      };
+
+      socket.onerror = (e) => {
+        this.logger.debug('error', e);
+      };
+
+      socket.onclose = () => {
+        clearTimeout(_timeout);
+
+        if (this.socket !== socket) { // not opened
+          reject(new Error('lan endpoint is not reachable'));
+          return;
+        }
+
+        this.logger.debug('close');
+        this.socket = null;
+        this.onClose();
+      };
+
+      socket.onmessage = (e) => {
+        this.onMessage(new Uint8Array(e.data as ArrayBuffer));
+      };
+    });
+  }
+
+  send(encodedMessage: Uint8Array): void {
+    if (!this.open) {
+      throw new Error('lan transport is not open');
+    }
+
+    this.socket!.send(encodedMessage);
+  }
+
+  close(): void {
+    this.socket?.close();
+  }
+}
+
+export default LanTransport;
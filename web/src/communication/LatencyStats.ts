@@ -0,0 +1,153 @@
+import type { ClientTransportKind } from "@/communication/Client";
+import { TimingFields, WebMessageKind } from "@/communication/Protocol";
+
+export type LatencyMetric = 'rtt' | 'transport' | 'queue' | 'rf';
+
+export interface LatencySample {
+  readonly kind: WebMessageKind;
+  readonly via: ClientTransportKind;
+  /**
+   * performance.now() when the request was sent [ms]
+   */
+  readonly sentAt: number;
+  readonly rtt: number;
+  readonly transport: number;
+  readonly queue: number;
+  /**
+   * undefined if the reply did not need the card
+   */
+  readonly rf?: number;
+}
+
+export interface LatencyPercentiles {
+  readonly count: number;
+  readonly p50: number;
+  readonly p90: number;
+  readonly p99: number;
+  readonly max: number;
+}
+
+export interface LatencySummary {
+  readonly via?: ClientTransportKind;
+  /**
+   * Device uptime minus performance.now() [ms], undefined until the first pong with timestamps
+   */
+  readonly clockOffset?: number;
+  readonly metrics: Record<LatencyMetric, LatencyPercentiles | null>;
+}
+
+const metrics: LatencyMetric[] = ['rtt', 'transport', 'queue', 'rf'];
+
+function round(ms: number): number {
+  return Math.round(ms * 1000) / 1000;
+}
+
+function percentiles(values: number[]): LatencyPercentiles | null {
+  if (values.length === 0) {
+    return null;
+  }
+
+  const sorted = [...values].sort((a, b) => a - b);
+  const at = (p: number) => sorted[Math.max(0, Math.ceil(p * sorted.length) - 1)];
+
+  return {
+    count: sorted.length,
+    p50: at(.5),
+    p90: at(.9),
+    p99: at(.99),
+    max: sorted[sorted.length - 1],
+  };
+}
+
+/**
+ * Splits round trips of requests by the device timestamps in their replies ($timing), over a rolling window:
+ * - transport: round trip without the time the request spent on the device (both directions)
+ * - queue: from the receive on the device to the card access, or to the publish if the card was not needed
+ * - rf: card access
+ *
+ * Window restarts when the transport changes, since latencies over lan and over the broker are not comparable.
+ * Clock offset is estimated from pongs the same way as NTP does, using the one with the shortest transport.
+ */
+export default class LatencyStats {
+  static readonly WindowSize = 256;
+  static readonly ClockWindowSize = 16;
+
+  private samples: LatencySample[] = [];
+  private clockSamples: { transport: number, offset: number }[] = [];
+
+  add(
+    kind: WebMessageKind,
+    via: ClientTransportKind,
+    sentAt: number,
+    receivedAt: number,
+    timing: TimingFields,
+  ): LatencySample {
+    const rxDevice = Number(timing.rx) / 1000;
+    const txDevice = rxDevice + timing.tx / 1000;
+    const rtt = receivedAt - sentAt;
+
+    const sample: LatencySample = {
+      kind,
+      via,
+      sentAt: round(sentAt),
+      rtt: round(rtt),
+      transport: round(rtt - timing.tx / 1000),
+      queue: round((timing.rf?.start ?? timing.tx) / 1000),
+      rf: timing.rf === undefined ? undefined : round((timing.rf.end - timing.rf.start) / 1000),
+    };
+
+    if (this.samples.length > 0 && this.samples[this.samples.length - 1].via !== via) {
+      this.samples = [];
+    }
+
+    this.samples.push(sample);
+
+    if (this.samples.length > LatencyStats.WindowSize) {
+      this.samples.shift();
+    }
+
+    if (kind === 'ping') {
+      this.clockSamples.push({
+        transport: sample.transport,
+        offset: ((rxDevice - sentAt) + (txDevice - receivedAt)) / 2,
+      });
+
+      if (this.clockSamples.length > LatencyStats.ClockWindowSize) {
+        this.clockSamples.shift();
+      }
+    }
+
+    return sample;
+  }
+
+  get clockOffset(): number | undefined {
+    if (this.clockSamples.length === 0) {
+      return undefined;
+    }
+
+    return round(this.clockSamples.reduce((best, sample) => sample.transport < best.transport ? sample : best).offset);
+  }
+
+  summary(): LatencySummary {
+    return {
+      via: this.samples[this.samples.length - 1]?.via,
+      clockOffset: this.clockOffset,
+      metrics: Object.fromEntries(metrics.map(metric => [
+        metric,
+        percentiles(this.samples.map(sample => sample[metric]).filter((value): value is number => value !== undefined)),
+      ])) as Record<LatencyMetric, LatencyPercentiles | null>,
+    };
+  }
+
+  /**
+   * Summary with the samples it is computed from, all times in milliseconds
+   */
+  toJSON() {
+    return {
+      exportedAt: new Date().toISOString(),
+      timeOrigin: performance.timeOrigin,
+      ...this.summary(),
+      samples: this.samples,
+    };
+  }
+}
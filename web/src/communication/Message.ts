@@ -1,23 +1,11 @@
 import Dto from "@/communication/Dto";
 import PiccKeyDto from "@/communication/dtos/PiccKeyDto";
+import { DeviceMessageKind, TimingFields, WebMessageKind } from "@/communication/Protocol";
 import { keySize } from "@/models/MifareClassic/MifareClassicAuthorization";
 import { keyA, keyB } from "@/models/Picc";
 import { assert } from "@/utils/helpers";
 
-export type WebMessageKind =
-  | 'ping'
-  | 'get_picc'
-  | 'read_sector'
-  | 'write_block';
-
-export type DeviceMessageKind =
-  | 'pong'
-  | 'picc'
-  | 'picc_sector'
-  | 'picc_block'
-  | 'hello'
-  | 'picc_state_changed'
-  | 'error';
+export type { DeviceMessageKind, WebMessageKind };
 
 type WebMessageId = string;
 
@@ -30,6 +18,10 @@ export interface DeviceMessageContext extends Dto {
 export interface DeviceMessage extends Message {
   readonly $kind: DeviceMessageKind;
   readonly $ctx?: DeviceMessageContext;
+  /**
+   * Device timestamps of the request handling, carried by replies if enabled on the device
+   */
+  readonly $timing?: TimingFields;
 }
 
 export interface WebMessage extends Message {
@@ -0,0 +1,252 @@
+// Generated by protocol/generate.py from protocol/schema.json, do not edit
+
+export type WebMessageKind =
+  | 'ping'
+  | 'get_picc'
+  | 'read_sector'
+  | 'write_block'
+  | 'get_snapshots'
+  | 'get_trace'
+  | 'hello'
+  | 'get_rf_stats';
+
+export type DeviceMessageKind =
+  | 'hello'
+  | 'error'
+  | 'pong'
+  | 'picc'
+  | 'picc_state_changed'
+  | 'picc_sector'
+  | 'picc_block'
+  | 'picc_block_changed'
+  | 'snapshot'
+  | 'snapshots'
+  | 'trace_chunk'
+  | 'trace'
+  | 'log'
+  | 'rf_stats';
+
+export interface PiccFields {
+  readonly state: number;
+  /**
+   * null if the picc is not selected
+   */
+  readonly uid: Uint8Array | null;
+  readonly type: number;
+  readonly atqa: number;
+  readonly sak: number;
+}
+
+export interface PiccBlockFields {
+  readonly address: number;
+  /**
+   * null if the block is not readable with any of the used keys
+   */
+  readonly data: Uint8Array | null;
+}
+
+export interface PiccKeyFields {
+  readonly type: number;
+  readonly value: Uint8Array;
+}
+
+export interface TimingSpanFields {
+  /**
+   * microseconds after rx
+   */
+  readonly start: number;
+  /**
+   * microseconds after rx
+   */
+  readonly end: number;
+}
+
+export interface TimingFields {
+  /**
+   * device time the request was received, in microseconds since boot
+   */
+  readonly rx: number | bigint;
+  /**
+   * card access, absent if the reply did not need the card (e.g. served from a snapshot)
+   */
+  readonly rf?: TimingSpanFields;
+  /**
+   * microseconds after rx the reply was published
+   */
+  readonly tx: number;
+}
+
+export interface RfStatsFields {
+  /**
+   * polling mode of the rf scheduler
+   */
+  readonly mode: string;
+  /**
+   * worst-case card detection latency of the mode
+   */
+  readonly interval_ms: number;
+  /**
+   * scan windows opened in idle mode
+   */
+  readonly scan_windows: number;
+  /**
+   * card accesses which paused polling
+   */
+  readonly batches: number;
+  readonly batch_us: number | bigint;
+  readonly idle_us: number | bigint;
+  readonly aggressive_us: number | bigint;
+  readonly paused_us: number | bigint;
+  /**
+   * cards detected by the first poll after the scanner was resumed, detection latency is measured for these
+   */
+  readonly detections: number;
+  /**
+   * from the resume of the scanner to the picc_state_changed event
+   */
+  readonly detection_last_us: number;
+  readonly detection_max_us: number;
+  readonly detection_avg_us: number;
+}
+
+export interface PingWebMessageFields { }
+
+export interface GetPiccWebMessageFields { }
+
+export interface ReadSectorWebMessageFields {
+  readonly offset: number;
+  readonly $key: PiccKeyFields;
+  /**
+   * key of the other type, used for blocks not readable with the key
+   */
+  readonly $alt_key?: PiccKeyFields;
+}
+
+export interface WriteBlockWebMessageFields {
+  readonly address: number;
+  readonly data: Uint8Array;
+  readonly $key: PiccKeyFields;
+}
+
+export interface GetSnapshotsWebMessageFields { }
+
+export interface GetTraceWebMessageFields { }
+
+export interface HelloWebMessageFields { }
+
+export interface GetRfStatsWebMessageFields { }
+
+/**
+ * Sent on connection with the broker (without $ctx), and in response to hello
+ */
+export interface HelloDeviceMessageFields {
+  /**
+   * url of the websocket endpoint on the local network
+   */
+  readonly lan?: string;
+}
+
+export interface ErrorDeviceMessageFields {
+  readonly code: number;
+  /**
+   * device timestamps of the request handling, if enabled on the device
+   */
+  readonly $timing?: TimingFields;
+}
+
+/**
+ * Device uptime in $timing (rx + tx) is used by the client to estimate the offset of its clock
+ */
+export interface PongDeviceMessageFields {
+  /**
+   * device timestamps of the request handling, if enabled on the device
+   */
+  readonly $timing?: TimingFields;
+}
+
+export interface PiccDeviceMessageFields {
+  readonly picc: PiccFields;
+}
+
+export interface PiccStateChangedDeviceMessageFields {
+  readonly old_state: number;
+  readonly picc: PiccFields;
+}
+
+/**
+ * Message without $ctx is an unsolicited update of the sector (e.g. after snapshot re-verification)
+ */
+export interface PiccSectorDeviceMessageFields {
+  readonly offset: number;
+  readonly blocks: PiccBlockFields[];
+  /**
+   * device timestamps of the request handling, if enabled on the device
+   */
+  readonly $timing?: TimingFields;
+}
+
+export interface PiccBlockDeviceMessageFields {
+  readonly address: number;
+  readonly data: Uint8Array;
+  /**
+   * device timestamps of the request handling, if enabled on the device
+   */
+  readonly $timing?: TimingFields;
+}
+
+/**
+ * Broadcast after every successful write of a block, regardless of the writer
+ */
+export interface PiccBlockChangedDeviceMessageFields {
+  readonly uid: Uint8Array;
+  readonly address: number;
+  readonly data: Uint8Array;
+}
+
+/**
+ * Sector stored in the snapshot store, sent in response to get_snapshots
+ */
+export interface SnapshotDeviceMessageFields {
+  readonly uid: Uint8Array;
+  readonly offset: number;
+  readonly key: PiccKeyFields;
+  /**
+   * unix time of the read in seconds (uptime in seconds if the device time was not synced)
+   */
+  readonly timestamp: number;
+  readonly blocks: PiccBlockFields[];
+}
+
+/**
+ * Terminates the sequence of snapshot messages
+ */
+export interface SnapshotsDeviceMessageFields {
+  readonly count: number;
+}
+
+export interface TraceChunkDeviceMessageFields {
+  readonly offset: number;
+  readonly data: Uint8Array;
+}
+
+/**
+ * Terminates the sequence of trace_chunk messages
+ */
+export interface TraceDeviceMessageFields {
+  readonly size: number;
+}
+
+/**
+ * Unsolicited batch of raw deferred log records, decoded with firmware/tools/dlog
+ */
+export interface LogDeviceMessageFields {
+  readonly records: Uint8Array;
+  readonly dropped: number;
+}
+
+/**
+ * Statistics of the card polling, sent in response to get_rf_stats
+ */
+export interface RfStatsDeviceMessageFields {
+  readonly stats: RfStatsFields;
+}
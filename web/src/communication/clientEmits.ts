@@ -1,6 +1,7 @@
 import ClientCloseEvent from "@/communication/events/ClientCloseEvent";
 import ClientDisconnectEvent from "@/communication/events/ClientDisconnectEvent";
 import ClientEndEvent from "@/communication/events/ClientEndEvent";
+import ClientLatencyEvent from "@/communication/events/ClientLatencyEvent";
 import ClientMessageEvent from "@/communication/events/ClientMessageEvent";
 import ClientOfflineEvent from "@/communication/events/ClientOfflineEvent";
 import ClientPingEvent from "@/communication/events/ClientPingEvent";
@@ -8,6 +9,7 @@ import ClientPongEvent from "@/communication/events/ClientPongEvent";
 import ClientPongMissedEvent from "@/communication/events/ClientPongMissedEvent";
 import ClientReadyEvent from "@/communication/events/ClientReadyEvent";
 import ClientReconnectEvent from "@/communication/events/ClientReconnectEvent";
+import ClientTransportEvent from "@/communication/events/ClientTransportEvent";
 import mitt from "mitt";
 
 const clientEmits = mitt<{
@@ -21,6 +23,8 @@ const clientEmits = mitt<{
   'close': ClientCloseEvent;
   'offline': ClientOfflineEvent;
   'end': ClientEndEvent;
+  'transport': ClientTransportEvent;
+  'latency': ClientLatencyEvent;
 }>();
 
 export default clientEmits;
@@ -0,0 +1,8 @@
+import clientEmits from "@/communication/clientEmits";
+import ClientLatencyEvent from "@/communication/events/ClientLatencyEvent";
+import { onMounted, onUnmounted } from "vue";
+
+export default function onClientLatency(hook: (e: ClientLatencyEvent) => void) {
+  onMounted(() => clientEmits.on('latency', hook));
+  onUnmounted(() => clientEmits.off('latency', hook));
+}
@@ -0,0 +1,8 @@
+import clientEmits from "@/communication/clientEmits";
+import ClientTransportEvent from "@/communication/events/ClientTransportEvent";
+import { onMounted, onUnmounted } from "vue";
+
+export default function onClientTransport(hook: (e: ClientTransportEvent) => void) {
+  onMounted(() => clientEmits.on('transport', hook));
+  onUnmounted(() => clientEmits.off('transport', hook));
+}
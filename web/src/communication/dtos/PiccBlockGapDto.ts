@@ -0,0 +1,15 @@
+import Dto from "@/communication/Dto";
+import PiccBlockDto from "@/communication/dtos/PiccBlockDto";
+import { PiccBlockFields } from "@/communication/Protocol";
+
+/**
+ * Block which is not readable with any of the keys used in sector read.
+ */
+export default interface PiccBlockGapDto extends Dto, PiccBlockFields {
+  readonly address: number;
+  readonly data: null;
+}
+
+export function isPiccBlockGapDto(block: PiccBlockDto | PiccBlockGapDto): block is PiccBlockGapDto {
+  return block.data === null;
+}
@@ -1,6 +1,7 @@
 import Dto from "@/communication/Dto";
+import { PiccFields } from "@/communication/Protocol";
 
-export default interface PiccDto extends Dto {
+export default interface PiccDto extends Dto, PiccFields {
   readonly type: number;
   readonly state: number;
   readonly atqa: number;
@@ -1,6 +1,7 @@
 import Dto from "@/communication/Dto";
+import { PiccKeyFields } from "@/communication/Protocol";
 
-export default interface PiccKeyDto extends Dto {
+export default interface PiccKeyDto extends Dto, PiccKeyFields {
   value: Uint8Array;
   type: 0 | 1;
 }
@@ -1,7 +1,8 @@
 import Dto from "@/communication/Dto";
 import PiccBlockDto from "@/communication/dtos/PiccBlockDto";
+import PiccBlockGapDto from "@/communication/dtos/PiccBlockGapDto";
 
 export default interface PiccSectorDto extends Dto {
   readonly offset: number;
-  readonly blocks: PiccBlockDto[];
+  readonly blocks: (PiccBlockDto | PiccBlockGapDto)[];
 }
@@ -0,0 +1,14 @@
+import PiccKeyDto from "@/communication/dtos/PiccKeyDto";
+import PiccSectorDto from "@/communication/dtos/PiccSectorDto";
+
+/**
+ * Sector stored in the device snapshot store.
+ */
+export default interface PiccSnapshotDto extends PiccSectorDto {
+  readonly uid: Uint8Array;
+  readonly key: PiccKeyDto;
+  /**
+   * Unix time of the read in seconds (uptime in seconds if the device time was not synced).
+   */
+  readonly timestamp: number;
+}
@@ -0,0 +1,13 @@
+import Client from "@/communication/Client";
+import { ClientEvent } from "@/communication/events/ClientEvent";
+import { LatencySample, LatencySummary } from "@/communication/LatencyStats";
+
+export default class ClientLatencyEvent extends ClientEvent {
+  constructor(
+    readonly client: Client,
+    readonly sample: LatencySample,
+    readonly summary: LatencySummary,
+  ) {
+    super(client);
+  }
+}
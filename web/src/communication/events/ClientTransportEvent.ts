@@ -0,0 +1,11 @@
+import Client, { ClientTransportKind } from "@/communication/Client";
+import { ClientEvent } from "@/communication/events/ClientEvent";
+
+export default class ClientTransportEvent extends ClientEvent {
+  constructor(
+    readonly client: Client,
+    readonly transport: ClientTransportKind,
+  ) {
+    super(client);
+  }
+}
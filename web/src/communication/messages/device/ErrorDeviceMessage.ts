@@ -1,8 +1,7 @@
 import { DeviceMessage } from "@/communication/Message";
+import { ErrorDeviceMessageFields } from "@/communication/Protocol";
 
-export default interface ErrorDeviceMessage extends DeviceMessage {
-  readonly code: number;
-}
+export default interface ErrorDeviceMessage extends DeviceMessage, ErrorDeviceMessageFields { }
 
 export function isErrorDeviceMessage(message: DeviceMessage): message is ErrorDeviceMessage {
   return message.$kind === 'error';
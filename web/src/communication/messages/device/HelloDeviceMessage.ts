@@ -1,9 +1,10 @@
 import { DeviceMessage } from "@/communication/Message";
+import { HelloDeviceMessageFields } from "@/communication/Protocol";
 
 /**
- * Message sent by the device on connection with the broker.
+ * Message sent by the device on connection with the broker, and in response to hello.
  */
-export default interface HelloDeviceMessage extends DeviceMessage { }
+export default interface HelloDeviceMessage extends DeviceMessage, HelloDeviceMessageFields { }
 
 export function isHelloDeviceMessage(message: DeviceMessage): message is HelloDeviceMessage {
   return message.$kind === 'hello';
@@ -0,0 +1,11 @@
+import { DeviceMessage } from "@/communication/Message";
+import { LogDeviceMessageFields } from "@/communication/Protocol";
+
+/**
+ * Unsolicited batch of raw deferred log records, decoded with firmware/tools/dlog.
+ */
+export default interface LogDeviceMessage extends DeviceMessage, LogDeviceMessageFields { }
+
+export function isLogDeviceMessage(message: DeviceMessage): message is LogDeviceMessage {
+  return message.$kind === 'log';
+}
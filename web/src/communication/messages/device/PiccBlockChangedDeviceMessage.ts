@@ -0,0 +1,13 @@
+import PiccBlockDto from "@/communication/dtos/PiccBlockDto";
+import { DeviceMessage } from "@/communication/Message";
+import { PiccBlockChangedDeviceMessageFields } from "@/communication/Protocol";
+
+/**
+ * Message broadcast by the device after every successful write of a block, regardless of the writer.
+ */
+export default interface PiccBlockChangedDeviceMessage
+  extends DeviceMessage, PiccBlockDto, PiccBlockChangedDeviceMessageFields { }
+
+export function isPiccBlockChangedDeviceMessage(message: DeviceMessage): message is PiccBlockChangedDeviceMessage {
+  return message.$kind === 'picc_block_changed';
+}
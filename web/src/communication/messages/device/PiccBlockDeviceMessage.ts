@@ -1,7 +1,8 @@
 import PiccBlockDto from "@/communication/dtos/PiccBlockDto";
 import { DeviceMessage } from "@/communication/Message";
+import { PiccBlockDeviceMessageFields } from "@/communication/Protocol";
 
-export interface PiccBlockDeviceMessage extends DeviceMessage, PiccBlockDto { }
+export interface PiccBlockDeviceMessage extends DeviceMessage, PiccBlockDto, PiccBlockDeviceMessageFields { }
 
 export function isPiccBlockDeviceMessage(message: DeviceMessage): message is PiccBlockDeviceMessage {
   return message.$kind === 'picc_block';
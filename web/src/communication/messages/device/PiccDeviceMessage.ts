@@ -1,7 +1,8 @@
 import PiccDto from "@/communication/dtos/PiccDto";
 import { DeviceMessage } from "@/communication/Message";
+import { PiccDeviceMessageFields } from "@/communication/Protocol";
 
-export default interface PiccDeviceMessage extends DeviceMessage {
+export default interface PiccDeviceMessage extends DeviceMessage, PiccDeviceMessageFields {
   readonly picc: PiccDto;
 }
 
@@ -1,7 +1,10 @@
 import PiccSectorDto from "@/communication/dtos/PiccSectorDto";
 import { DeviceMessage } from "@/communication/Message";
+import { PiccSectorDeviceMessageFields } from "@/communication/Protocol";
 
-export default interface PiccSectorDeviceMessage extends DeviceMessage, PiccSectorDto { }
+export default interface PiccSectorDeviceMessage extends DeviceMessage, PiccSectorDto, PiccSectorDeviceMessageFields {
+  readonly blocks: PiccSectorDto['blocks'];
+}
 
 export function isPiccSectorDeviceMessage(message: DeviceMessage): message is PiccSectorDeviceMessage {
   return message.$kind === 'picc_sector';
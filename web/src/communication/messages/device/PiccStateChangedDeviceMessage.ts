@@ -1,7 +1,11 @@
 import PiccStateChangeDto from "@/communication/dtos/PiccStateChangeDto";
 import { DeviceMessage } from "@/communication/Message";
+import { PiccStateChangedDeviceMessageFields } from "@/communication/Protocol";
 
-export default interface PiccStateChangedDeviceMessage extends DeviceMessage, PiccStateChangeDto { }
+export default interface PiccStateChangedDeviceMessage
+  extends DeviceMessage, PiccStateChangeDto, PiccStateChangedDeviceMessageFields {
+  readonly picc: PiccStateChangeDto['picc'];
+}
 
 export function isPiccStateChangedDeviceMessage(message: DeviceMessage): message is PiccStateChangedDeviceMessage {
   return message.$kind === 'picc_state_changed';
@@ -1,6 +1,7 @@
 import { DeviceMessage } from "@/communication/Message";
+import { PongDeviceMessageFields } from "@/communication/Protocol";
 
-export default interface PongDeviceMessage extends DeviceMessage { }
+export default interface PongDeviceMessage extends DeviceMessage, PongDeviceMessageFields { }
 
 export function isPongDeviceMessage(message: DeviceMessage): message is PongDeviceMessage {
   return message.$kind === 'pong';
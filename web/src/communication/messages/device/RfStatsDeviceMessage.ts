@@ -0,0 +1,8 @@
+import { DeviceMessage } from "@/communication/Message";
+import { RfStatsDeviceMessageFields } from "@/communication/Protocol";
+
+export default interface RfStatsDeviceMessage extends DeviceMessage, RfStatsDeviceMessageFields { }
+
+export function isRfStatsDeviceMessage(message: DeviceMessage): message is RfStatsDeviceMessage {
+  return message.$kind === 'rf_stats';
+}
@@ -0,0 +1,12 @@
+import PiccSnapshotDto from "@/communication/dtos/PiccSnapshotDto";
+import { DeviceMessage } from "@/communication/Message";
+import { SnapshotDeviceMessageFields } from "@/communication/Protocol";
+
+export default interface SnapshotDeviceMessage extends DeviceMessage, PiccSnapshotDto, SnapshotDeviceMessageFields {
+  readonly key: PiccSnapshotDto['key'];
+  readonly blocks: PiccSnapshotDto['blocks'];
+}
+
+export function isSnapshotDeviceMessage(message: DeviceMessage): message is SnapshotDeviceMessage {
+  return message.$kind === 'snapshot';
+}
@@ -0,0 +1,11 @@
+import { DeviceMessage } from "@/communication/Message";
+import { SnapshotsDeviceMessageFields } from "@/communication/Protocol";
+
+/**
+ * Terminates the sequence of snapshot messages.
+ */
+export default interface SnapshotsDeviceMessage extends DeviceMessage, SnapshotsDeviceMessageFields { }
+
+export function isSnapshotsDeviceMessage(message: DeviceMessage): message is SnapshotsDeviceMessage {
+  return message.$kind === 'snapshots';
+}
@@ -0,0 +1,8 @@
+import { DeviceMessage } from "@/communication/Message";
+import { TraceChunkDeviceMessageFields } from "@/communication/Protocol";
+
+export default interface TraceChunkDeviceMessage extends DeviceMessage, TraceChunkDeviceMessageFields { }
+
+export function isTraceChunkDeviceMessage(message: DeviceMessage): message is TraceChunkDeviceMessage {
+  return message.$kind === 'trace_chunk';
+}
@@ -0,0 +1,11 @@
+import { DeviceMessage } from "@/communication/Message";
+import { TraceDeviceMessageFields } from "@/communication/Protocol";
+
+/**
+ * Terminates the sequence of trace_chunk messages.
+ */
+export default interface TraceDeviceMessage extends DeviceMessage, TraceDeviceMessageFields { }
+
+export function isTraceDeviceMessage(message: DeviceMessage): message is TraceDeviceMessage {
+  return message.$kind === 'trace';
+}
@@ -0,0 +1,8 @@
+import { BaseWebMessage, WebMessageKind } from "@/communication/Message";
+
+/**
+ * Device responds with the rf_stats message, statistics of its card polling.
+ */
+export default class GetRfStatsWebMessage extends BaseWebMessage {
+  readonly $kind: WebMessageKind = 'get_rf_stats';
+}
@@ -0,0 +1,8 @@
+import { BaseWebMessage, WebMessageKind } from "@/communication/Message";
+
+/**
+ * Device responds with a snapshot message per stored sector, followed by the snapshots message.
+ */
+export default class GetSnapshotsWebMessage extends BaseWebMessage {
+  readonly $kind: WebMessageKind = 'get_snapshots';
+}
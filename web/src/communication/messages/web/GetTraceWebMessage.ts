@@ -0,0 +1,8 @@
+import { BaseWebMessage, WebMessageKind } from "@/communication/Message";
+
+/**
+ * Device responds with a trace_chunk message per chunk of the recorded trace, followed by the trace message.
+ */
+export default class GetTraceWebMessage extends BaseWebMessage {
+  readonly $kind: WebMessageKind = 'get_trace';
+}
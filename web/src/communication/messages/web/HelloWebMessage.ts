@@ -0,0 +1,8 @@
+import { BaseWebMessage, WebMessageKind } from "@/communication/Message";
+
+/**
+ * Device responds with the hello message, which advertises its lan endpoint.
+ */
+export default class HelloWebMessage extends BaseWebMessage {
+  readonly $kind: WebMessageKind = 'hello';
+}
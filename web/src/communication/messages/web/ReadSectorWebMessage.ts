@@ -1,14 +1,31 @@
 import PiccKeyDto from "@/communication/dtos/PiccKeyDto";
 import { AuthorizedWebMessage, WebMessageKind } from "@/communication/Message";
+import { ReadSectorWebMessageFields } from "@/communication/Protocol";
+import { keySize } from "@/models/MifareClassic/MifareClassicAuthorization";
 import { assert, isByte } from "@/utils/helpers";
 
-export default class ReadSectorWebMessage extends AuthorizedWebMessage {
+export default class ReadSectorWebMessage extends AuthorizedWebMessage implements ReadSectorWebMessageFields {
   readonly $kind: WebMessageKind = 'read_sector';
 
-  constructor(readonly offset: number, key: PiccKeyDto) {
+  /**
+   * Key of the other type, used by the device for blocks which are not readable with the main key.
+   * Declared only, so it is not encoded at all if not provided.
+   */
+  declare readonly $alt_key?: PiccKeyDto;
+
+  constructor(readonly offset: number, key: PiccKeyDto, altKey?: PiccKeyDto) {
     assert(isByte(offset), 'invalid offset');
 
+    if (altKey) {
+      assert(altKey.value?.length === keySize, 'invalid alternative key length');
+      assert(altKey.type !== key.type, 'alternative key must be of the other type');
+    }
+
     super(key);
     this.offset = offset;
+
+    if (altKey) {
+      this.$alt_key = altKey;
+    }
   }
 }
@@ -1,12 +1,14 @@
 import PiccBlockDto from "@/communication/dtos/PiccBlockDto";
 import PiccKeyDto from "@/communication/dtos/PiccKeyDto";
 import { AuthorizedWebMessage, WebMessageKind } from "@/communication/Message";
+import { WriteBlockWebMessageFields } from "@/communication/Protocol";
 import { blockSize } from "@/models/MifareClassic/MifareClassic";
 import { throwIfAccessBitsIntegrityViolated } from "@/models/MifareClassic/MifareClassicAuthorization";
 import MifareClassicMemory from "@/models/MifareClassic/MifareClassicMemory";
 import { assert, isByte } from "@/utils/helpers";
 
-export default class WriteBlockWebMessage extends AuthorizedWebMessage implements PiccBlockDto {
+export default class WriteBlockWebMessage extends AuthorizedWebMessage
+  implements PiccBlockDto, WriteBlockWebMessageFields {
   readonly $kind: WebMessageKind = 'write_block';
 
   constructor(
@@ -1,10 +1,20 @@
-import Client from "@/communication/Client";
+import Client, { MessageReceiveTimeoutError } from "@/communication/Client";
+import clientEmits from "@/communication/clientEmits";
+import ClientMessageEvent from "@/communication/events/ClientMessageEvent";
+import { DeviceMessage, WebMessage } from "@/communication/Message";
+import { isLogDeviceMessage } from "@/communication/messages/device/LogDeviceMessage";
+import { isSnapshotDeviceMessage } from "@/communication/messages/device/SnapshotDeviceMessage";
+import { isSnapshotsDeviceMessage } from "@/communication/messages/device/SnapshotsDeviceMessage";
+import { isTraceChunkDeviceMessage } from "@/communication/messages/device/TraceChunkDeviceMessage";
+import { isTraceDeviceMessage } from "@/communication/messages/device/TraceDeviceMessage";
+import GetSnapshotsWebMessage from "@/communication/messages/web/GetSnapshotsWebMessage";
+import GetTraceWebMessage from "@/communication/messages/web/GetTraceWebMessage";
 import { isPiccSectorDeviceMessage } from "@/communication/messages/device/PiccSectorDeviceMessage";
 import ReadSectorWebMessage from "@/communication/messages/web/ReadSectorWebMessage";
 import WriteBlockWebMessage from "@/communication/messages/web/WriteBlockWebMessage";
 import { blockSize } from "@/models/MifareClassic/MifareClassic";
 import { AccessBitsComboPool, accessBitsComboPoolToBitsPool, accessBitsComboPoolToBytes, accessBitsPoolToBytes, defaultKey } from "@/models/MifareClassic/MifareClassicAuthorization";
-import { KeyType } from "@/models/Picc";
+import { keyA, keyB, KeyType } from "@/models/Picc";
 import { assert, bin, hex, unhexToArray } from "@/utils/helpers";
 import { logd } from "@/utils/Logger";
 
@@ -66,10 +76,12 @@ class NFCityConsole {
     offset: number,
     key: string = hex(defaultKey.value),
     keyType: KeyType = defaultKey.type,
+    altKey?: string,
   ) {
     assert(typeof offset === 'number');
     assert(typeof key === 'string');
     assert(typeof keyType === 'number');
+    assert(altKey === undefined || typeof altKey === 'string');
 
     const response = await this.client.transceive(
       new ReadSectorWebMessage(
@@ -77,6 +89,10 @@ class NFCityConsole {
         {
           value: Uint8Array.from(unhexToArray(key)),
           type: keyType,
+        },
+        altKey === undefined ? undefined : {
+          value: Uint8Array.from(unhexToArray(altKey)),
+          type: keyType === keyA ? keyB : keyA,
         }
       )
     );
@@ -87,13 +103,165 @@ class NFCityConsole {
       block.address,
       {
         address: hex(block.address),
-        data: hex(Array.from(block.data)),
+        data: block.data === null ? null : hex(Array.from(block.data)),
       }
     ])));
 
     return response;
   }
 
+  /**
+   * Sends the message and collects the messages device responds with, until the terminating one.
+   */
+  private async transceiveSequence<I extends DeviceMessage, T extends DeviceMessage>(
+    message: WebMessage,
+    isItem: (message: DeviceMessage) => message is I,
+    isTerminator: (message: DeviceMessage) => message is T,
+    timeoutMs: number,
+  ): Promise<{ items: I[], terminator: T }> {
+    const items: I[] = [];
+
+    const done = new Promise<T>((resolve, reject) => {
+      const _onMessageReceived = (e: ClientMessageEvent) => {
+        if (e.message.$ctx?.$id !== message.$id) {
+          return;
+        }
+
+        if (isItem(e.message)) {
+          items.push(e.message);
+          return;
+        }
+
+        clearTimeout(_timeout);
+        clientEmits.off('message', _onMessageReceived);
+
+        if (isTerminator(e.message)) {
+          resolve(e.message);
+        } else {
+          reject(e.message);
+        }
+      };
+
+      const _timeout = setTimeout(() => {
+        clientEmits.off('message', _onMessageReceived);
+        reject(new MessageReceiveTimeoutError());
+      }, timeoutMs);
+
+      clientEmits.on('message', _onMessageReceived);
+    });
+
+    await this.client.send(message);
+    const terminator = await done;
+
+    return { items, terminator };
+  }
+
+  /**
+   * Exports all snapshots stored by the device as JSON.
+   */
+  async exportSnapshots(timeoutMs: number = 10000): Promise<string> {
+    assert(typeof timeoutMs === 'number');
+
+    const { items: snapshots, terminator } = await this.transceiveSequence(
+      new GetSnapshotsWebMessage(),
+      isSnapshotDeviceMessage,
+      isSnapshotsDeviceMessage,
+      timeoutMs,
+    );
+
+    assert(terminator.count === snapshots.length, 'some snapshots were lost');
+
+    return JSON.stringify(snapshots.map(snapshot => ({
+      uid: hex(Array.from(snapshot.uid)),
+      offset: snapshot.offset,
+      key: {
+        type: snapshot.key.type,
+        value: hex(Array.from(snapshot.key.value)),
+      },
+      timestamp: snapshot.timestamp,
+      blocks: snapshot.blocks.map(block => ({
+        address: block.address,
+        data: block.data === null ? null : hex(Array.from(block.data)),
+      })),
+    })), null, 2);
+  }
+
+  /**
+   * Dumps the trace recorded by the device (see firmware/tools/replay) and downloads it as nfcity-trace.bin.
+   * Device clears the trace after the dump.
+   */
+  async dumpTrace(timeoutMs: number = 30000): Promise<Uint8Array> {
+    assert(typeof timeoutMs === 'number');
+
+    const { items: chunks, terminator } = await this.transceiveSequence(
+      new GetTraceWebMessage(),
+      isTraceChunkDeviceMessage,
+      isTraceDeviceMessage,
+      timeoutMs,
+    );
+
+    const trace = new Uint8Array(terminator.size);
+    let received = 0;
+
+    for (const chunk of chunks) {
+      trace.set(chunk.data, chunk.offset);
+      received += chunk.data.length;
+    }
+
+    assert(received === terminator.size, 'some trace chunks were lost');
+
+    this.download(trace, 'nfcity-trace.bin');
+
+    return trace;
+  }
+
+  /**
+   * Collects raw deferred log records published by the device (NFCity > Deferred logging > Publish raw records
+   * over MQTT) for @p durationMs and downloads them as nfcity-log.bin, see firmware/tools/dlog.
+   */
+  async captureLog(durationMs: number = 60000): Promise<Uint8Array> {
+    assert(typeof durationMs === 'number');
+
+    const batches: Uint8Array[] = [];
+    let dropped = 0;
+
+    const _onMessageReceived = (e: ClientMessageEvent) => {
+      if (isLogDeviceMessage(e.message)) {
+        batches.push(e.message.records);
+        dropped += e.message.dropped;
+      }
+    };
+
+    clientEmits.on('message', _onMessageReceived);
+    await new Promise(resolve => setTimeout(resolve, durationMs));
+    clientEmits.off('message', _onMessageReceived);
+
+    const records = new Uint8Array(batches.reduce((size, batch) => size + batch.length, 0));
+    let offset = 0;
+
+    for (const batch of batches) {
+      records.set(batch, offset);
+      offset += batch.length;
+    }
+
+    if (dropped > 0) {
+      console.warn(`${dropped} log records were dropped by the device`);
+    }
+
+    this.download(records, 'nfcity-log.bin');
+
+    return records;
+  }
+
+  private download(data: Uint8Array, fileName: string) {
+    const url = URL.createObjectURL(new Blob([data], { type: 'application/octet-stream' }));
+    const link = document.createElement('a');
+    link.href = url;
+    link.download = fileName;
+    link.click();
+    URL.revokeObjectURL(url);
+  }
+
   buildSectorTrailer(
     keyA: string,
     accessBitsComboPool: AccessBitsComboPool,
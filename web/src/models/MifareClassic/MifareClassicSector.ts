@@ -3,13 +3,17 @@ import { MifareClassicManufacturerBlock } from "@/models/MifareClassic/blocks/Mi
 import MifareClassicSectorTrailerBlock from "@/models/MifareClassic/blocks/MifareClassicSectorTrailerBlock";
 import MifareClassicUndefinedBlock from "@/models/MifareClassic/blocks/MifareClassicUndefinedBlock";
 import { isValueBlock, MifareClassicValueBlock } from "@/models/MifareClassic/blocks/MifareClassicValueBlock";
+import { blockSize } from "@/models/MifareClassic/MifareClassic";
 import MifareClassicBlock from "@/models/MifareClassic/MifareClassicBlock";
 import MifareClassicMemory from "@/models/MifareClassic/MifareClassicMemory";
-import { PiccKey, PiccSector, UpdatablePiccSector } from "@/models/Picc";
+import { KeyType, PiccBlockAccessBits, PiccKey, PiccSector, UpdatablePiccSector } from "@/models/Picc";
+
+const unknownAccessBits: PiccBlockAccessBits = { c1: 0, c2: 0, c3: 0 }; // as of undefined blocks
 
 export default class MifareClassicSector implements PiccSector {
   private _key?: PiccKey;
   private _offset?: number;
+  private readonly knownKeys = new Map<KeyType, PiccKey>();
 
   constructor(
     readonly memory: MifareClassicMemory,
@@ -23,6 +27,13 @@ export default class MifareClassicSector implements PiccSector {
     return this._key;
   }
 
+  /**
+   * Last key of @p type the sector was authenticated with, kept after deauthentication
+   */
+  knownKey(type: KeyType): PiccKey | undefined {
+    return this.knownKeys.get(type);
+  }
+
   get offset() {
     return this._offset ?? (this._offset = this.memory.offsetOfSector(this));
   }
@@ -57,6 +68,7 @@ export default class MifareClassicSector implements PiccSector {
 
   authenticate(key: PiccKey): void {
     this._key = key;
+    this.knownKeys.set(key.type, key);
   }
 
   deauthenticate(): void {
@@ -72,16 +84,25 @@ export default class MifareClassicSector implements PiccSector {
       throw new Error('Invalid number of blocks');
     }
 
-    const trailer = new MifareClassicSectorTrailerBlock(this,
-      sector.blocks.at(-1)! // FIXME: !
-    );
+    const trailerBlock = sector.blocks.at(-1)!; // FIXME: !
 
-    this.blocks[this.trailerOffset] = trailer;
+    // trailer is not readable with any of the used keys, so access bits of the data blocks are unknown
+    const trailer = trailerBlock.data.length === blockSize
+      ? new MifareClassicSectorTrailerBlock(this, trailerBlock)
+      : null;
+
+    this.blocks[this.trailerOffset] = trailer ?? new MifareClassicUndefinedBlock(this, trailerBlock.address);
 
     sector.blocks.slice(0, -1)
       .forEach((block, offset) => {
         const accessPoolIndex = this.accessPoolIndexOfBlockAtOffset(offset);
-        const accessBits = trailer.accessBitsPool[accessPoolIndex];
+        const accessBits = trailer?.accessBitsPool[accessPoolIndex] ?? unknownAccessBits;
+
+        // block is not readable with the key(s) used in authentication
+        if (block.data.length !== blockSize) {
+          this.blocks[offset] = new MifareClassicUndefinedBlock(this, block.address);
+          return;
+        }
 
         if (block.address === 0) {
           this.blocks[offset] = new MifareClassicManufacturerBlock(this, { ...block, accessBits });